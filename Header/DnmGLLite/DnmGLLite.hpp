@@ -5,9 +5,11 @@
 #include "DnmGLLite/Utility/Flag.hpp"
 #include "DnmGLLite/Utility/Math.hpp"
 
+#include <atomic>
 #include <cstdint>
 #include <expected>
 #include <functional>
+#include <map>
 #include <optional>
 #include <print>
 #include <format>
@@ -17,6 +19,7 @@
 #include <filesystem>
 #include <unordered_set>
 #include <source_location>
+#include <coroutine>
 
 namespace DnmGLLite {
     class Context;
@@ -41,6 +44,9 @@ namespace DnmGLLite {
     #define DnmGLLiteAssert(condition, fmt, ...) \
         DnmGLAssertFunc(std::source_location::current().function_name(), #condition, condition, fmt, __VA_ARGS__);
 
+    // GetBindlessIndex of resources without a slot in the bindless table
+    constexpr uint32_t InvalidBindlessIndex = UINT32_MAX;
+
     //TODO: add compressed formats
     //equal to VkFormat
     enum class Format : uint8_t {
@@ -271,6 +277,50 @@ namespace DnmGLLite {
     };
     using PipelineStageFlags = Flags<PipelineStageBits>;
 
+    // how a command uses a resource, see CommandBuffer::Barrier
+    enum class ResourceUsage : uint8_t {
+        // previous use isn't known, waits every command before the barrier
+        eUnknown,
+        eIndirectRead,
+        eVertexRead,
+        eUniformRead,
+        eShaderRead,
+        // storage buffers and images, also read
+        eShaderWrite,
+        eColorAttachment,
+        eDepthStencilAttachment,
+        eTransferRead,
+        eTransferWrite,
+        // mapped reads after the submit completes
+        eHostRead,
+    };
+
+    [[nodiscard]] constexpr bool IsWriteUsage(ResourceUsage usage) {
+        switch (usage) {
+            case ResourceUsage::eUnknown:
+            case ResourceUsage::eShaderWrite:
+            case ResourceUsage::eColorAttachment:
+            case ResourceUsage::eDepthStencilAttachment:
+            case ResourceUsage::eTransferWrite: return true;
+            default: return false;
+        }
+    }
+
+    // execution and memory dependency between commands using a resource as src_usage and the ones using it as dst_usage
+    struct ResourceBarrierDesc {
+        ResourceUsage src_usage;
+        ResourceUsage dst_usage;
+
+        auto operator<=>(const ResourceBarrierDesc&) const = default;
+    };
+
+    // resource the commands after a barrier use, see CommandBuffer::Barrier
+    struct BarrierResource {
+        DnmGLLite::Image* image;
+        const DnmGLLite::Buffer* buffer;
+        ResourceUsage usage;
+    };
+
     struct Color { uint8_t r, g, b, a; };
     struct ColorFloat { float r, g, b, a; };
 
@@ -372,6 +422,22 @@ namespace DnmGLLite {
         uint32_t array_element;
     };
 
+    // one descriptor of ResourceManager::SetResources, members used depend on the binding type:
+    // buffer, size and offset for buffers, image and subresource for storage images, sampler too for textures
+    struct DescriptorResource {
+        DnmGLLite::Buffer* buffer;
+        uint64_t size;
+        uint32_t offset;
+
+        DnmGLLite::Image* image;
+        DnmGLLite::Sampler* sampler;
+        ImageSubresource subresource;
+    };
+
+    // constant_id to 32 bit value, bools are 0 or 1 and floats std::bit_cast.
+    // ids must be declared by the shader, undeclared constants keep their default
+    using SpecializationConstants = std::map<uint32_t, uint32_t>;
+
     struct GraphicsPipelineDesc {
         Shader* vertex_shader;
         Shader* fragment_shader;
@@ -411,13 +477,40 @@ namespace DnmGLLite {
         // color_load_op, color_store_op
         // and attachments
         // SetAttachments dosn't anything for color attachments, uses swapchain images
+        // (offscreen render targets in headless context, see Context::GetRenderTargetImage)
         bool presenting : 1;
         bool color_blend : 1;
+        // applied to each stage declaring the id
+        SpecializationConstants specialization_constants{};
     };
 
     struct ComputePipelineDesc {
         Shader* shader;
         ResourceManager* resource_manager;
+        // e.g. work group size with local_size_x_id
+        SpecializationConstants specialization_constants{};
+    };
+
+    //same with vulkan, argument layouts of indirect commands
+    struct DrawIndirectCommand {
+        uint32_t vertex_count;
+        uint32_t instance_count;
+        uint32_t first_vertex;
+        uint32_t first_instance;
+    };
+
+    struct DrawIndexedIndirectCommand {
+        uint32_t index_count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t vertex_offset;
+        uint32_t first_instance;
+    };
+
+    struct DispatchIndirectCommand {
+        uint32_t x;
+        uint32_t y;
+        uint32_t z;
     };
 
     struct BufferToBufferCopyDesc {
@@ -536,13 +629,71 @@ namespace DnmGLLite {
     }
 
     struct ContextDesc {
+        //in headless mode, extent of the offscreen render targets
         Uint2 window_extent;
+        //std::nullopt for headless context (no surface and swapchain)
         WindowHandle window_handle;
         bool Vsync;
+        // how many frames cpu can record while gpu executing previous ones
+        uint32_t frames_in_flight = 2;
+        // per frame, CommandBuffer::UploadData bigger than this uses a dedicated staging buffer
+        uint32_t staging_buffer_size = 16 * 1024 * 1024;
+        // per frame, how many threads can record secondary command buffers in one render pass
+        uint32_t secondary_command_buffer_count = 16;
+        // VkPipelineCache file, saved when context destroyed. pipelines created in the last run precompiled at Init,
+        // shader reflections saved next to it. empty keeps the caches in memory
+        std::filesystem::path pipeline_cache_path{};
+        // per frame, how many CommandBuffer::BeginScope timings can be measured, later scopes aren't. 0 disables gpu timestamps
+        uint32_t gpu_scope_count = 64;
+        // global descriptor table bound at set 0: storage buffers (binding 0), sampled images (1), storage images (2)
+        // and samplers (3), shaders index them with GetBindlessIndex of the resources. sets of resource managers
+        // start from 1. ignored if device doesn't support descriptor indexing with update after bind.
+        // uses through the table aren't tracked, record a CommandBuffer::Barrier between a write and later uses of it
+        bool bindless = false;
+        // array sizes of the bindless table, clamped to device limits
+        uint32_t bindless_buffer_count = 65536;
+        uint32_t bindless_image_count = 16384;
+        uint32_t bindless_sampler_count = 256;
+    };
+
+    struct GpuScopeTiming {
+        std::string name;
+        // nesting level, 0 for outermost scopes
+        uint32_t depth;
+        float milliseconds;
     };
 
     using CallbackFunc = std::function<void(std::string_view message, MessageType error, std::string_view source)>;
 
+    enum class QueueType : uint8_t {
+        eGraphics,
+        eCompute,
+    };
+
+    // completion of one ExecuteCommands/Render/ExecuteComputeAsync submit, cheap to copy.
+    // default constructed or not submitted (func returned false) tickets are always complete
+    class GpuTicket {
+    public:
+        GpuTicket() = default;
+        GpuTicket(Context* context, uint64_t value, QueueType queue = QueueType::eGraphics) 
+            : context(context), value(value), queue(queue) {}
+
+        [[nodiscard]] bool IsComplete() const;
+        // returns false on timeout
+        bool Wait(uint64_t timeout_ns = UINT64_MAX) const;
+        [[nodiscard]] uint64_t GetValue() const { return value; }
+        [[nodiscard]] QueueType GetQueue() const { return queue; }
+
+        // co_await ticket; resumed in Context::PollTickets
+        bool await_ready() const { return IsComplete(); }
+        void await_suspend(std::coroutine_handle<> handle) const;
+        void await_resume() const noexcept {}
+    private:
+        Context* context = nullptr;
+        uint64_t value = 0;
+        QueueType queue = QueueType::eGraphics;
+    };
+
     class Context {
     public:
         virtual ~Context() = default;
@@ -551,19 +702,45 @@ namespace DnmGLLite {
 
         virtual void Init(const ContextDesc&) = 0;
         //offline rendering
-        virtual void ExecuteCommands(const std::function<bool(CommandBuffer*)>& func) = 0;
+        virtual GpuTicket ExecuteCommands(const std::function<bool(CommandBuffer*)>& func) = 0;
         //ExecuteCommands + present image
-        virtual void Render(const std::function<bool(CommandBuffer*)>& func) = 0;
+        virtual GpuTicket Render(const std::function<bool(CommandBuffer*)>& func) = 0;
+        // submits on compute queue (graphics queue if device has no other), next ExecuteCommands/Render waits it.
+        // storage buffers and images are shared between queues, other resources must not be used by both.
+        // barriers don't order the queues, wait_ticket is the last graphics submit reading or writing what func uses
+        virtual GpuTicket ExecuteComputeAsync(const std::function<bool(CommandBuffer*)>& func, GpuTicket wait_ticket = {}) = 0;
         virtual void WaitForGPU() = 0;
+
+        [[nodiscard]] virtual bool IsTicketComplete(uint64_t value, QueueType queue) = 0;
+        virtual bool WaitTicket(uint64_t value, QueueType queue, uint64_t timeout_ns) = 0;
+        virtual void ResumeOnTicketComplete(uint64_t value, QueueType queue, std::coroutine_handle<> handle) = 0;
+        // resumes coroutines waiting completed tickets, also called at start of ExecuteCommands/Render
+        virtual void PollTickets() = 0;
         virtual void Vsync(bool) = 0;
 
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::Buffer> CreateBuffer(const DnmGLLite::BufferDesc&) noexcept = 0;
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::Image> CreateImage(const DnmGLLite::ImageDesc&) noexcept = 0;
+        // images share one memory allocation, only one of them holds valid content at a time.
+        // content is undefined after another one is written, see CommandBuffer::DiscardContent. memory freed with the last image
+        [[nodiscard]] virtual std::vector<std::unique_ptr<DnmGLLite::Image>> CreateAliasedImages(std::span<const DnmGLLite::ImageDesc>) noexcept = 0;
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::Sampler> CreateSampler(const DnmGLLite::SamplerDesc&) noexcept = 0;
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::Shader> CreateShader(const std::filesystem::path&) noexcept = 0;
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::ResourceManager> CreateResourceManager(std::span<const DnmGLLite::Shader*>) noexcept = 0;
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::ComputePipeline> CreateComputePipeline(const DnmGLLite::ComputePipelineDesc&) noexcept = 0;
         [[nodiscard]] virtual std::unique_ptr<DnmGLLite::GraphicsPipeline> CreateGraphicsPipeline(const DnmGLLite::GraphicsPipelineDesc&) noexcept = 0;
+        // compiled on a worker thread, IsReady is false until then. binding a pipeline that isn't ready skips
+        // draws or dispatches recorded until the next bind, so a frame never waits for compilation
+        [[nodiscard]] virtual std::unique_ptr<DnmGLLite::ComputePipeline> CreateComputePipelineAsync(const DnmGLLite::ComputePipelineDesc&) noexcept = 0;
+        [[nodiscard]] virtual std::unique_ptr<DnmGLLite::GraphicsPipeline> CreateGraphicsPipelineAsync(const DnmGLLite::GraphicsPipelineDesc&) noexcept = 0;
+        // copied on transfer queue when device has one, visible to commands from the next ExecuteCommands/Render.
+        // for new or streamed in resources that gpu doesn't use in frames in flight
+        virtual void UploadDataAsync(const Buffer* buffer, const void* data, uint32_t size, uint32_t offset) = 0;
+        virtual void UploadDataAsync(Image* image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset) = 0;
+        //headless only, image written by the last Render(). nullptr when rendering to a window
+        [[nodiscard]] virtual DnmGLLite::Image* GetRenderTargetImage() const noexcept = 0;
+        // scopes of the latest frame gpu finished, read without waiting so frames_in_flight frames behind.
+        // in begin order, empty if device doesn't support timestamps
+        [[nodiscard]] virtual std::span<const GpuScopeTiming> GetGpuScopeTimings() const noexcept = 0;
 
         [[nodiscard]] constexpr DnmGLLite::Image* GetPlaceholderImage() const noexcept { return placeholder_image; };
         [[nodiscard]] constexpr DnmGLLite::Sampler* GetPlaceholderSampler() const noexcept { return placeholder_sampler; };
@@ -580,6 +757,18 @@ namespace DnmGLLite {
         CallbackFunc callback_func;
     };
 
+    inline bool GpuTicket::IsComplete() const {
+        return value == 0 || context->IsTicketComplete(value, queue);
+    }
+
+    inline bool GpuTicket::Wait(uint64_t timeout_ns) const {
+        return value == 0 || context->WaitTicket(value, queue, timeout_ns);
+    }
+
+    inline void GpuTicket::await_suspend(std::coroutine_handle<> handle) const {
+        context->ResumeOnTicketComplete(value, queue, handle);
+    }
+
     class ContextLoader {
     public:
         ContextLoader() = default;
@@ -620,8 +809,11 @@ namespace DnmGLLite {
         [[nodiscard]] constexpr T* GetMappedPtr() const noexcept { return reinterpret_cast<T*>(m_mapped_ptr); }
 
         [[nodiscard]] constexpr const auto& GetDesc() const noexcept { return m_desc; }
+        // storage buffers only, InvalidBindlessIndex if bindless disabled or table full
+        [[nodiscard]] constexpr uint32_t GetBindlessIndex() const noexcept { return m_bindless_index; }
     protected:
         uint8_t* m_mapped_ptr;
+        uint32_t m_bindless_index = InvalidBindlessIndex;
 
         DnmGLLite::BufferDesc m_desc;
     };
@@ -636,8 +828,12 @@ namespace DnmGLLite {
         virtual ~Image() = default;
 
         [[nodiscard]] constexpr const auto& GetDesc() const noexcept { return m_desc; }
+        // same index in sampled and storage image arrays, view covers every layer and mipmap.
+        // sampled or storage images only, InvalidBindlessIndex if bindless disabled or table full
+        [[nodiscard]] constexpr uint32_t GetBindlessIndex() const noexcept { return m_bindless_index; }
     protected:
         DnmGLLite::ImageDesc m_desc;
+        uint32_t m_bindless_index = InvalidBindlessIndex;
     };
 
     class Sampler : public RHIObject {
@@ -650,8 +846,11 @@ namespace DnmGLLite {
         virtual ~Sampler() = default;
 
         [[nodiscard]] constexpr const auto& GetDesc() const noexcept { return m_desc; }
+        // InvalidBindlessIndex if bindless disabled or table full
+        [[nodiscard]] constexpr uint32_t GetBindlessIndex() const noexcept { return m_bindless_index; }
     protected:
         DnmGLLite::SamplerDesc m_desc;
+        uint32_t m_bindless_index = InvalidBindlessIndex;
     };
 
     class Shader : public RHIObject {
@@ -679,6 +878,8 @@ namespace DnmGLLite {
         virtual void SetResourceAsBuffer(std::span<const BufferResource> update_resource) = 0;
         virtual void SetResourceAsImage(std::span<const ImageResource> update_resource) = 0;
         virtual void SetResourceAsTexture(std::span<const TextureResource> update_resource) = 0;
+        // writes every descriptor of set at once, resources in binding order then array element order
+        virtual void SetResources(uint32_t set, std::span<const DescriptorResource> resources) = 0;
 
         [[nodiscard]] constexpr const auto& GetShaders() const noexcept { return m_shaders; }
     protected:
@@ -700,8 +901,11 @@ namespace DnmGLLite {
         virtual ~GraphicsPipeline() = default;
 
         [[nodiscard]] constexpr const auto& GetDesc() const noexcept { return m_desc; }
+        // false while an async pipeline compiles, see Context::CreateGraphicsPipelineAsync
+        [[nodiscard]] bool IsReady() const noexcept { return m_ready.load(std::memory_order_acquire); }
     protected:
         GraphicsPipelineDesc m_desc;
+        std::atomic<bool> m_ready = true;
     };
 
     class ComputePipeline : public RHIObject {
@@ -713,8 +917,11 @@ namespace DnmGLLite {
         virtual ~ComputePipeline() = default;
 
          [[nodiscard]] constexpr const auto& GetDesc() const noexcept { return m_desc; }
+        // false while an async pipeline compiles, see Context::CreateComputePipelineAsync
+        [[nodiscard]] bool IsReady() const noexcept { return m_ready.load(std::memory_order_acquire); }
     protected:
         ComputePipelineDesc m_desc;
+        std::atomic<bool> m_ready = true;
     };
 
     class CommandBuffer : public RHIObject {
@@ -726,17 +933,61 @@ namespace DnmGLLite {
         virtual void Begin() = 0;
         virtual void End() = 0;
 
+        // with secondary_contents, rendering commands only recorded in secondaries, see BeginSecondary.
+        // pipeline's attachments are the render target, pass_pipelines are the other pipelines bound in the pass,
+        // indirect_buffers the argument and count buffers of its indirect draws. their resources are synchronized before the pass begins
         virtual void BeginRendering(
             const DnmGLLite::GraphicsPipeline *pipeline,
             std::span<const DnmGLLite::ColorFloat> color_clear_values, 
-            std::optional<DnmGLLite::DepthStencilClearValue> depth_stencil_clear_value) = 0;
+            std::optional<DnmGLLite::DepthStencilClearValue> depth_stencil_clear_value,
+            bool secondary_contents = false,
+            std::span<const DnmGLLite::GraphicsPipeline* const> pass_pipelines = {},
+            std::span<const DnmGLLite::Buffer* const> indirect_buffers = {}) = 0;
+        // pipeline given to BeginRendering
         virtual void EndRendering(const DnmGLLite::GraphicsPipeline *pipeline) = 0;
+        // between BeginRendering and EndRendering, pipeline is the pass' pipeline or in its pass_pipelines.
+        // attachment formats and sample count must match the pass' pipeline
+        virtual void BindPipeline(const DnmGLLite::GraphicsPipeline* pipeline) = 0;
+
+        // thread safe for different indices. returned command buffer continues the render pass, pipeline is its pipeline 
+        // or one of its pass_pipelines. pipeline and its resources are bound but viewport and scissor are not inherited. call End when done.
+        // only pipelines of the pass, draw state, push constants and draws can be recorded in it
+        virtual CommandBuffer* BeginSecondary(const DnmGLLite::GraphicsPipeline *pipeline, uint32_t index) = 0;
+        // executes ended secondaries in index order, called on the recording thread before EndRendering
+        virtual void ExecuteSecondaries() = 0;
+
+        // gpu time between BeginScope and EndScope, see Context::GetGpuScopeTimings. scopes can be nested.
+        // only measured in command buffers of ExecuteCommands/Render, not in a render pass with secondary_contents.
+        // commands don't open scopes themselves, place one around a batch of uploads instead of each
+        virtual void BeginScope(std::string_view name) = 0;
+        virtual void EndScope() = 0;
+
+        // all barriers in one pipeline barrier, image layouts aren't changed. outside of render passes.
+        // resources are used with their usage after it and every earlier use is waited by barriers, 
+        // binding pipelines and beginning render passes don't wait them again (see RenderGraph)
+        virtual void Barrier(std::span<const ResourceBarrierDesc> barriers, std::span<const BarrierResource> resources = {}) = 0;
+        // content of image is undefined from here, its next use transitions it from an undefined layout.
+        // for aliased images before the first use after another image of the memory. records nothing
+        virtual void DiscardContent(DnmGLLite::Image *image) = 0;
 
         virtual void BindPipeline(const DnmGLLite::ComputePipeline* pipeline) = 0;
+        virtual void Dispatch(uint32_t x = 1, uint32_t y = 1, uint32_t z = 1) = 0;
 
         virtual void Draw(uint32_t vertex_count, uint32_t instance_count) = 0;
         virtual void DrawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t vertex_offset) = 0;
 
+        // argument buffers need BufferUsageBits::eIndirect, stride 0 is tightly packed commands.
+        // draws take buffers in indirect_buffers of BeginRendering, DispatchIndirect waits earlier writes itself
+        virtual void DrawIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset, uint32_t draw_count, uint32_t stride = 0) = 0;
+        virtual void DrawIndexedIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset, uint32_t draw_count, uint32_t stride = 0) = 0;
+        // draw count is an uint32_t read from count_buffer, at most max_draw_count.
+        // not recorded if device doesn't support draw indirect count
+        virtual void DrawIndirectCount(const DnmGLLite::Buffer* buffer, uint64_t offset, 
+            const DnmGLLite::Buffer* count_buffer, uint64_t count_offset, uint32_t max_draw_count, uint32_t stride = 0) = 0;
+        virtual void DrawIndexedIndirectCount(const DnmGLLite::Buffer* buffer, uint64_t offset, 
+            const DnmGLLite::Buffer* count_buffer, uint64_t count_offset, uint32_t max_draw_count, uint32_t stride = 0) = 0;
+        virtual void DispatchIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset) = 0;
+
         virtual void SetViewport(Float2 extent, Float2 offset, float min_depth, float max_depth) = 0;
         virtual void SetScissor(Uint2 extent, Uint2 offset) = 0;
 
@@ -0,0 +1,44 @@
+#include "DnmGLLite/DnmGLLite.hpp"
+
+#include <dlfcn.h>
+
+namespace DnmGLLite::Linux {
+    class ContextLoader : DnmGLLite::ContextLoader {
+    public:
+        ContextLoader(std::string_view shared_path) {
+            //TODO: choose dx and vulkan api
+            shared = dlopen(shared_path.data(), RTLD_NOW | RTLD_LOCAL);
+            if (!shared) {
+                //throw DnmGLLite::Error("failed to context lib load");
+                return;
+            }
+
+            const auto load_func = (DnmGLLite::Context*((*)()))dlsym(shared, "LoadContext");
+            if (!load_func) {
+                dlclose(shared);
+                shared = nullptr;
+                //throw DnmGLLite::Error("failed to context load function");
+                return;
+            }
+
+            context = load_func();
+        }
+
+        ~ContextLoader() {
+            if (context) {
+                delete context;
+                dlclose(shared);
+            }
+        }
+
+        DnmGLLite::Context *GetContext() const { return context; }
+
+        ContextLoader(ContextLoader&&) = delete;
+        ContextLoader(ContextLoader&) = delete;
+        ContextLoader& operator=(ContextLoader&&) = delete;
+        ContextLoader& operator=(ContextLoader&) = delete;
+    private:
+        DnmGLLite::Context *context = nullptr;
+        void* shared = nullptr;
+    };
+};
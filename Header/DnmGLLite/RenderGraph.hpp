@@ -0,0 +1,286 @@
+#pragma once
+
+#include "DnmGLLite.hpp"
+#include <algorithm>
+
+namespace DnmGLLite {
+    // index of an image or buffer in its RenderGraph
+    struct RenderGraphResource {
+        uint32_t index = UINT32_MAX;
+
+        [[nodiscard]] bool IsValid() const { return index != UINT32_MAX; }
+        bool operator==(const RenderGraphResource&) const = default;
+    };
+
+    struct RenderGraphAccess {
+        RenderGraphResource resource;
+        ResourceUsage usage;
+    };
+
+    // passes declare the resources they use, Compile culls passes nothing depends on,
+    // aliases memory of transient images with disjoint lifetimes and derives the barriers run before each pass.
+    // barriers are memory and execution dependencies, image layouts are still handled by the command buffer.
+    // it doesn't wait the resources of a pass again, so passes use them only as declared.
+    // passes and resources are fixed after Compile, Execute records the graph once per frame
+    class RenderGraph {
+    public:
+        using PassFunc = std::function<void(DnmGLLite::RenderGraph& graph, DnmGLLite::CommandBuffer* command_buffer)>;
+
+        RenderGraph(DnmGLLite::Context& context) : m_context(context) {}
+
+        // imported resources are owned by the user, writing them keeps the pass alive
+        RenderGraphResource ImportImage(DnmGLLite::Image* image);
+        RenderGraphResource ImportBuffer(DnmGLLite::Buffer* buffer);
+        // created by Compile, content is undefined at the first pass using it each frame
+        RenderGraphResource CreateImage(const DnmGLLite::ImageDesc& desc);
+
+        // one access per resource, ResourceUsage::eShaderWrite for read write storage.
+        // BeginRendering/EndRendering are called by func, barriers are recorded outside of them
+        void AddPass(std::string_view name, std::span<const RenderGraphAccess> accesses, PassFunc func, bool never_cull = false);
+
+        void Compile();
+        void Execute(DnmGLLite::CommandBuffer* command_buffer);
+
+        // nullptr for transients before Compile or used by culled passes only
+        [[nodiscard]] DnmGLLite::Image* GetImage(RenderGraphResource resource) const { return m_resources[resource.index].image; }
+        [[nodiscard]] DnmGLLite::Buffer* GetBuffer(RenderGraphResource resource) const { return m_resources[resource.index].buffer; }
+
+        [[nodiscard]] uint32_t GetPassCount() const { return m_passes.size(); }
+        [[nodiscard]] uint32_t GetCulledPassCount() const { return m_passes.size() - m_compiled_passes.size(); }
+        // pass in AddPass order
+        [[nodiscard]] bool IsPassCulled(uint32_t pass) const { return FindCompiledPass(pass) == nullptr; }
+        // recorded before pass, sorted. empty for culled passes
+        [[nodiscard]] std::span<const ResourceBarrierDesc> GetPassBarriers(uint32_t pass) const {
+            const auto* compiled_pass = FindCompiledPass(pass);
+            return compiled_pass ? std::span<const ResourceBarrierDesc>(compiled_pass->barriers) : std::span<const ResourceBarrierDesc>{};
+        }
+        // transient images sharing memory count as one
+        [[nodiscard]] uint32_t GetTransientAllocationCount() const { return m_alias_slot_count; }
+    private:
+        struct Resource {
+            DnmGLLite::Image* image{};
+            DnmGLLite::Buffer* buffer{};
+            std::optional<DnmGLLite::ImageDesc> transient_desc{};
+            // transient images in the same slot share memory
+            uint32_t alias_slot = UINT32_MAX;
+        };
+
+        struct Pass {
+            std::string name;
+            std::vector<RenderGraphAccess> accesses;
+            PassFunc func;
+            bool never_cull;
+        };
+
+        struct CompiledPass {
+            uint32_t pass_index;
+            std::vector<ResourceBarrierDesc> barriers;
+            // accesses of the pass, waited by barriers
+            std::vector<BarrierResource> resources{};
+            // transients first used by this pass, their aliases left the memory in another layout last frame
+            std::vector<RenderGraphResource> discards{};
+        };
+
+        // key of the memory a resource uses, transients in the same alias slot share it
+        [[nodiscard]] uint32_t GetMemoryKey(RenderGraphResource resource) const {
+            const auto& res = m_resources[resource.index];
+            return res.transient_desc ? static_cast<uint32_t>(m_resources.size()) + res.alias_slot : resource.index;
+        }
+
+        [[nodiscard]] const CompiledPass* FindCompiledPass(uint32_t pass) const {
+            const auto it = std::ranges::find(m_compiled_passes, pass, &CompiledPass::pass_index);
+            return it == m_compiled_passes.end() ? nullptr : &*it;
+        }
+
+        void CullPasses();
+        void AliasTransients();
+        void DeriveBarriers();
+
+        DnmGLLite::Context& m_context;
+        std::vector<Resource> m_resources{};
+        std::vector<Pass> m_passes{};
+        std::vector<CompiledPass> m_compiled_passes{};
+
+        std::vector<DnmGLLite::Image::Ptr> m_transient_images{};
+        uint32_t m_alias_slot_count{};
+        bool m_compiled = false;
+    };
+
+    inline RenderGraphResource RenderGraph::ImportImage(DnmGLLite::Image* image) {
+        DnmGLLiteAssert(!m_compiled, "render graph resources can't be added after Compile")
+        m_resources.emplace_back(Resource{.image = image});
+        return {static_cast<uint32_t>(m_resources.size() - 1)};
+    }
+
+    inline RenderGraphResource RenderGraph::ImportBuffer(DnmGLLite::Buffer* buffer) {
+        DnmGLLiteAssert(!m_compiled, "render graph resources can't be added after Compile")
+        m_resources.emplace_back(Resource{.buffer = buffer});
+        return {static_cast<uint32_t>(m_resources.size() - 1)};
+    }
+
+    inline RenderGraphResource RenderGraph::CreateImage(const DnmGLLite::ImageDesc& desc) {
+        DnmGLLiteAssert(!m_compiled, "render graph resources can't be added after Compile")
+        m_resources.emplace_back(Resource{.transient_desc = desc});
+        return {static_cast<uint32_t>(m_resources.size() - 1)};
+    }
+
+    inline void RenderGraph::AddPass(std::string_view name, std::span<const RenderGraphAccess> accesses, PassFunc func, bool never_cull) {
+        DnmGLLiteAssert(!m_compiled, "render graph passes can't be added after Compile")
+        for (uint32_t i{}; i < accesses.size(); ++i) {
+            DnmGLLiteAssert(accesses[i].resource.index < m_resources.size(), "pass {} uses an invalid resource", name)
+            for (uint32_t j = i + 1; j < accesses.size(); ++j) {
+                DnmGLLiteAssert(accesses[i].resource != accesses[j].resource, "pass {} uses resource {} more than once", name, accesses[i].resource.index)
+            }
+        }
+
+        m_passes.emplace_back(
+            std::string(name),
+            std::vector<RenderGraphAccess>(accesses.begin(), accesses.end()),
+            std::move(func),
+            never_cull);
+    }
+
+    inline void RenderGraph::Compile() {
+        DnmGLLiteAssert(!m_compiled, "render graph is already compiled")
+        CullPasses();
+        AliasTransients();
+        DeriveBarriers();
+        m_compiled = true;
+    }
+
+    inline void RenderGraph::Execute(DnmGLLite::CommandBuffer* command_buffer) {
+        DnmGLLiteAssert(m_compiled, "render graph must be compiled before Execute")
+        for (const auto& compiled_pass : m_compiled_passes) {
+            auto& pass = m_passes[compiled_pass.pass_index];
+
+            command_buffer->BeginScope(pass.name);
+            for (const auto resource : compiled_pass.discards) {
+                command_buffer->DiscardContent(GetImage(resource));
+            }
+            command_buffer->Barrier(compiled_pass.barriers, compiled_pass.resources);
+            pass.func(*this, command_buffer);
+            command_buffer->EndScope();
+        }
+    }
+
+    inline void RenderGraph::CullPasses() {
+        // walked backward, a pass is alive if a later alive pass uses what it writes
+        std::vector<bool> used_resources(m_resources.size(), false);
+        std::vector<bool> alive_passes(m_passes.size(), false);
+
+        for (uint32_t i = m_passes.size(); i-- > 0;) {
+            const auto& pass = m_passes[i];
+            bool alive = pass.never_cull;
+            for (const auto& access : pass.accesses) {
+                if (!IsWriteUsage(access.usage)) continue;
+                const bool imported = !m_resources[access.resource.index].transient_desc;
+                alive |= imported || used_resources[access.resource.index];
+            }
+            if (!alive) continue;
+
+            alive_passes[i] = true;
+            for (const auto& access : pass.accesses) {
+                used_resources[access.resource.index] = true;
+            }
+        }
+
+        for (uint32_t i{}; i < m_passes.size(); ++i) {
+            if (alive_passes[i]) m_compiled_passes.emplace_back(i);
+        }
+    }
+
+    inline void RenderGraph::AliasTransients() {
+        struct Lifetime {
+            uint32_t resource_index;
+            uint32_t first = UINT32_MAX;
+            uint32_t last{};
+        };
+
+        // in compiled pass order
+        std::vector<Lifetime> lifetimes{};
+        for (uint32_t i{}; i < m_compiled_passes.size(); ++i) {
+            for (const auto& access : m_passes[m_compiled_passes[i].pass_index].accesses) {
+                if (!m_resources[access.resource.index].transient_desc) continue;
+
+                auto it = std::ranges::find(lifetimes, access.resource.index, &Lifetime::resource_index);
+                if (it == lifetimes.end()) {
+                    it = lifetimes.insert(it, Lifetime{.resource_index = access.resource.index, .first = i});
+                }
+                it->last = i;
+            }
+        }
+
+        // greedy, a slot is reused by the first transient that starts after its last pass
+        std::vector<uint32_t> slot_last_pass{};
+        std::vector<std::vector<uint32_t>> slot_resources{};
+        for (const auto& lifetime : lifetimes) {
+            auto slot_it = std::ranges::find_if(slot_last_pass, [&lifetime] (uint32_t last) { return last < lifetime.first; });
+            if (slot_it == slot_last_pass.end()) {
+                slot_last_pass.emplace_back(lifetime.last);
+                slot_resources.emplace_back();
+                slot_it = slot_last_pass.end() - 1;
+            }
+            else {
+                *slot_it = lifetime.last;
+            }
+
+            const uint32_t slot = slot_it - slot_last_pass.begin();
+            slot_resources[slot].emplace_back(lifetime.resource_index);
+            m_resources[lifetime.resource_index].alias_slot = slot;
+            m_compiled_passes[lifetime.first].discards.emplace_back(lifetime.resource_index);
+        }
+
+        m_alias_slot_count = slot_resources.size();
+        for (const auto& resources : slot_resources) {
+            std::vector<DnmGLLite::ImageDesc> descs{};
+            descs.reserve(resources.size());
+            for (const auto index : resources) {
+                descs.emplace_back(*m_resources[index].transient_desc);
+            }
+
+            auto images = m_context.CreateAliasedImages(descs);
+            for (uint32_t i{}; i < resources.size(); ++i) {
+                m_resources[resources[i]].image = images[i].get();
+                m_transient_images.emplace_back(std::move(images[i]));
+            }
+        }
+    }
+
+    inline void RenderGraph::DeriveBarriers() {
+        // last write and reads after it for each memory key, unknown at the beginning of the frame
+        struct MemoryState {
+            ResourceUsage last_write = ResourceUsage::eUnknown;
+            std::vector<ResourceUsage> reads{};
+        };
+        std::vector<MemoryState> states(m_resources.size() + m_alias_slot_count);
+
+        for (auto& compiled_pass : m_compiled_passes) {
+            auto& barriers = compiled_pass.barriers;
+            for (const auto& access : m_passes[compiled_pass.pass_index].accesses) {
+                auto& state = states[GetMemoryKey(access.resource)];
+                compiled_pass.resources.emplace_back(GetImage(access.resource), GetBuffer(access.resource), access.usage);
+
+                if (IsWriteUsage(access.usage)) {
+                    // write after read waits the reads, write after write waits the write
+                    if (state.reads.empty()) {
+                        barriers.emplace_back(state.last_write, access.usage);
+                    }
+                    for (const auto read : state.reads) {
+                        barriers.emplace_back(read, access.usage);
+                    }
+                    state.last_write = access.usage;
+                    state.reads.clear();
+                }
+                else if (std::ranges::find(state.reads, access.usage) == state.reads.end()) {
+                    // reads of the same usage are already visible
+                    barriers.emplace_back(state.last_write, access.usage);
+                    state.reads.emplace_back(access.usage);
+                }
+            }
+
+            std::ranges::sort(barriers);
+            const auto [first, last] = std::ranges::unique(barriers);
+            barriers.erase(first, last);
+        }
+    }
+}
@@ -429,6 +429,7 @@ namespace DnmGLLite {
         DnmGLLiteAssert(m_camera_ptr , "m_camera_ptr cannot be null");
 
         if (m_sprite_count) {
+            command_buffer->BeginScope("RenderSprites");
             command_buffer->BeginRendering(
                 m_graphics_pipeline.get(), 
                 std::span(&clear_color, 1), 
@@ -444,6 +445,7 @@ namespace DnmGLLite {
             command_buffer->Draw(4, m_sprite_count);
             
                 command_buffer->EndRendering(m_graphics_pipeline.get());
+            command_buffer->EndScope();
         }
     }
 }
@@ -30,11 +30,17 @@ enum class OS {
 #   error "unsupported OS"
 #endif
 
-#ifdef ENGINE_EXPORT
-    #define ENGINE_API __declspec(dllexport)
+#ifdef OS_WIN
+    #ifdef ENGINE_EXPORT
+        #define ENGINE_API __declspec(dllexport)
+    #else
+        #define ENGINE_API __declspec(dllimport)
+    #endif
+    #define SHARED_LIB_EXPORT __declspec(dllexport)
 #else
-    #define ENGINE_API __declspec(dllimport)
-//TODO: add linux, mac, ios etc. support
+    #define ENGINE_API __attribute__((visibility("default")))
+    #define SHARED_LIB_EXPORT __attribute__((visibility("default")))
+//TODO: add mac, ios etc. support
 #endif
 
 #ifdef _DEBUG
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "DnmGLLite/Vulkan/Context.hpp"
+
+namespace DnmGLLite::Vulkan {
+    enum class BindlessArray : uint8_t {
+        eBuffer,
+        eImage,
+        eSampler,
+    };
+
+    // one update after bind, partially bound set with a big array per resource type, see ContextDesc::bindless.
+    // descriptors written when the index is added, removed indices reused once the gpu completes the ticket
+    // they're retired with. not thread safe
+    class BindlessTable {
+    public:
+        static constexpr uint32_t storage_buffer_binding = 0;
+        static constexpr uint32_t sampled_image_binding = 1;
+        static constexpr uint32_t storage_image_binding = 2;
+        static constexpr uint32_t sampler_binding = 3;
+
+        BindlessTable(Vulkan::Context& context, uint32_t buffer_count, uint32_t image_count, uint32_t sampler_count);
+        ~BindlessTable();
+
+        [[nodiscard]] vk::DescriptorSetLayout GetSetLayout() const { return m_set_layout; }
+        [[nodiscard]] vk::DescriptorSet GetSet() const { return m_set; }
+
+        // InvalidBindlessIndex if the array is full
+        [[nodiscard]] uint32_t AddBuffer(vk::Buffer buffer);
+        // view written to the arrays of the image's usage, layout is the sampled image layout
+        [[nodiscard]] uint32_t AddImage(vk::ImageView image_view, vk::ImageLayout layout, bool sampled, bool storage);
+        [[nodiscard]] uint32_t AddSampler(vk::Sampler sampler);
+        // index must not be used by submits after ticket
+        void Remove(BindlessArray array, uint32_t index, const Context::RetireTicket& ticket);
+        // reuses indices retired until completed_ticket
+        void Collect(const Context::RetireTicket& completed_ticket);
+    private:
+        struct IndexAllocator {
+            uint32_t count{};
+            uint32_t next{};
+            std::vector<uint32_t> free_indices{};
+        };
+
+        struct RetiredIndex {
+            BindlessArray array;
+            uint32_t index;
+            Context::RetireTicket ticket;
+        };
+
+        [[nodiscard]] uint32_t AllocateIndex(BindlessArray array);
+        [[nodiscard]] IndexAllocator& GetIndexAllocator(BindlessArray array) { return m_index_allocators[static_cast<uint32_t>(array)]; }
+
+        Vulkan::Context& m_context;
+        vk::DescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+        vk::DescriptorPool m_pool = VK_NULL_HANDLE;
+        vk::DescriptorSet m_set = VK_NULL_HANDLE;
+
+        // indexed by BindlessArray
+        std::array<IndexAllocator, 3> m_index_allocators{};
+        // in release order, so values of each timeline never decrease
+        std::vector<RetiredIndex> m_retired_indices{};
+    };
+}
\ No newline at end of file
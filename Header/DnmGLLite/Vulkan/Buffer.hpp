@@ -10,8 +10,15 @@ namespace DnmGLLite::Vulkan {
 
         [[nodiscard]] auto GetBuffer() const { return m_buffer; }
         [[nodiscard]] auto* GetAllocation() const { return m_allocation; }
+        // concurrent for storage buffers when async compute has its own queue family
+        [[nodiscard]] auto GetSharingMode() const { return m_sharing_mode; }
     private:
         vk::Buffer m_buffer;
         VmaAllocation m_allocation;
+        vk::SharingMode m_sharing_mode = vk::SharingMode::eExclusive;
+
+        // changed by recorded commands, buffers are const in them
+        mutable ResourceState m_state{};
+        friend Vulkan::CommandBuffer;
     };
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DnmGLLite/Vulkan/Context.hpp"
+#include <bitset>
 
 namespace DnmGLLite::Vulkan {
     struct TransferImageLayoutDesc {
@@ -21,14 +22,76 @@ namespace DnmGLLite::Vulkan {
         vk::PipelineStageFlags dst_pipeline_stages;
         vk::AccessFlags src_access;
         vk::AccessFlags dst_access;
+        // aspect replaced by image_aspect
+        vk::ImageSubresourceRange range = whole_image_range;
+    };
+
+    struct BarrierStages {
+        vk::PipelineStageFlags src;
+        vk::PipelineStageFlags dst;
+    };
+
+    // stages and accesses of queues without graphics, barriers recorded for them are masked with these
+    constexpr vk::PipelineStageFlags compute_queue_stages = vk::PipelineStageFlagBits::eTopOfPipe 
+        | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader 
+        | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eBottomOfPipe 
+        | vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eAllCommands;
+    constexpr vk::AccessFlags compute_queue_access = vk::AccessFlagBits::eIndirectCommandRead 
+        | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite 
+        | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite 
+        | vk::AccessFlagBits::eHostRead | vk::AccessFlagBits::eHostWrite 
+        | vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+
+    // state recorded in a command buffer since Begin, commands setting it to the same value are skipped
+    struct BoundState {
+        struct BindPoint {
+            vk::Pipeline pipeline = VK_NULL_HANDLE;
+            // layout the sets were bound with, a set stays bound while set layouts up to it and push constant ranges match
+            std::vector<vk::DescriptorSetLayout> set_layouts{};
+            std::vector<vk::PushConstantRange> push_constant_ranges{};
+            std::vector<vk::DescriptorSet> sets{};
+            // last bound pipeline is still compiling, its draws or dispatches are skipped
+            bool pipeline_pending = false;
+        };
+
+        // indexed by vk::PipelineBindPoint, graphics and compute
+        std::array<BindPoint, 2> bind_points{};
+
+        vk::Buffer vertex_buffer = VK_NULL_HANDLE;
+        uint64_t vertex_buffer_offset{};
+        vk::Buffer index_buffer = VK_NULL_HANDLE;
+        uint64_t index_buffer_offset{};
+        vk::IndexType index_type{};
+
+        std::optional<vk::Viewport> viewport{};
+        std::optional<vk::Rect2D> scissor{};
+
+        // pushes bigger than push_constant_data aren't cached
+        std::vector<vk::PushConstantRange> push_constant_ranges{};
+        std::array<std::byte, 256> push_constant_data{};
+        std::bitset<256> push_constant_valid{};
+    };
+
+    // buffer or image used by the next command, see CommandBuffer::ResourceBarrier
+    struct ResourceAccess {
+        const Vulkan::Buffer* buffer;
+        Vulkan::Image* image;
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags access;
+        // eUndefined keeps the image's layout
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        // subresources of image the barrier and layout apply to
+        vk::ImageSubresourceRange range = whole_image_range;
     };
 
     class CommandBuffer final : public DnmGLLite::CommandBuffer {
     public:
-        CommandBuffer(Vulkan::Context& context);
+        // use_frame_staging false for command buffers not submitted with graphics frames
+        CommandBuffer(Vulkan::Context& context, vk::CommandPool command_pool, bool use_frame_staging = true, 
+            vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
         ~CommandBuffer() noexcept {
             VulkanContext
-                ->GetDevice().freeCommandBuffers(VulkanContext->GetCommandPool(), command_buffer);
+                ->GetDevice().freeCommandBuffers(m_command_pool, command_buffer);
         }
     
         void Begin() override;
@@ -38,8 +101,22 @@ namespace DnmGLLite::Vulkan {
         void BeginRendering(
             const DnmGLLite::GraphicsPipeline *pipeline,
             std::span<const DnmGLLite::ColorFloat> color_clear_values, 
-            std::optional<DnmGLLite::DepthStencilClearValue> depth_stencil_clear_value) override;
+            std::optional<DnmGLLite::DepthStencilClearValue> depth_stencil_clear_value,
+            bool secondary_contents = false,
+            std::span<const DnmGLLite::GraphicsPipeline* const> pass_pipelines = {},
+            std::span<const DnmGLLite::Buffer* const> indirect_buffers = {}) override;
         void EndRendering(const DnmGLLite::GraphicsPipeline *pipeline) override;
+        void BindPipeline(const DnmGLLite::GraphicsPipeline* pipeline) override;
+
+        DnmGLLite::CommandBuffer* BeginSecondary(const DnmGLLite::GraphicsPipeline *pipeline, uint32_t index) override;
+        void ExecuteSecondaries() override;
+
+        // no-op without timestamp query pool (compute and upload command buffers), not allowed in secondaries
+        void BeginScope(std::string_view name) override;
+        void EndScope() override;
+
+        // one global memory barrier, layouts stay ideal between commands
+        void Barrier(std::span<const ResourceBarrierDesc> barriers, std::span<const BarrierResource> resources = {}) override;
 
         void UploadData(DnmGLLite::Image *image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset) override;
         void UploadData(const DnmGLLite::Buffer *buffer, const void* data, uint32_t size, uint32_t offset) override;
@@ -52,17 +129,26 @@ namespace DnmGLLite::Vulkan {
         void TransferImageLayout(std::span<const TransferImageLayoutDesc> desc) const;
         void TransferImageLayout(std::span<const TransferImageLayoutNativeDesc> desc) const;
     
-        void Dispatch(uint32_t x = 1, uint32_t y = 1, uint32_t z = 1);
+        void Dispatch(uint32_t x = 1, uint32_t y = 1, uint32_t z = 1) override;
 
         void BindPipeline(const DnmGLLite::ComputePipeline* pipeline) override;
 
         void GenerateMipmaps(DnmGLLite::Image* image) override;
+        void DiscardContent(DnmGLLite::Image* image) override;
     
         void BindVertexBuffer(const DnmGLLite::Buffer* buffer, uint64_t offset) override;
         void BindIndexBuffer(const DnmGLLite::Buffer* buffer, uint64_t offset, DnmGLLite::IndexType index_type) override;
     
         void Draw(uint32_t vertex_count, uint32_t instance_count) override;
         void DrawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t vertex_offset) override;
+
+        void DrawIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) override;
+        void DrawIndexedIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) override;
+        void DrawIndirectCount(const DnmGLLite::Buffer* buffer, uint64_t offset, 
+            const DnmGLLite::Buffer* count_buffer, uint64_t count_offset, uint32_t max_draw_count, uint32_t stride) override;
+        void DrawIndexedIndirectCount(const DnmGLLite::Buffer* buffer, uint64_t offset, 
+            const DnmGLLite::Buffer* count_buffer, uint64_t count_offset, uint32_t max_draw_count, uint32_t stride) override;
+        void DispatchIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset) override;
     
         void PushConstant(const DnmGLLite::GraphicsPipeline* pipeline, DnmGLLite::ShaderStageFlags pipeline_stage, uint32_t offset, uint32_t size, const void *ptr) override;
         void PushConstant(const DnmGLLite::ComputePipeline* pipeline, DnmGLLite::ShaderStageFlags pipeline_stage, uint32_t offset, uint32_t size, const void *ptr) override;
@@ -70,59 +156,135 @@ namespace DnmGLLite::Vulkan {
         void SetViewport(Float2 extent, Float2 offset, float min_depth, float max_depth) override;
         void SetScissor(Uint2 extent, Uint2 offset) override;
     private:
+        // VK_KHR_dynamic_rendering with the pipeline's attachment views, attachments already transitioned
+        void BeginDynamicRendering(
+            const Vulkan::GraphicsPipeline *pipeline,
+            std::span<const DnmGLLite::ColorFloat> color_clear_values, 
+            std::optional<DnmGLLite::DepthStencilClearValue> depth_stencil_clear_value,
+            bool secondary_contents);
         void TransferImageLayoutDefaultVk(std::span<const TransferImageLayoutNativeDesc> descs) const;
         void TransferImageLayoutSync2(std::span<const TransferImageLayoutNativeDesc> descs) const;
         
-        void ResourceBarrier(ResourceAccessInfo res_access_info, ResourceAccessInfo image_access_info);
+        // buffer and image barriers only for accesses that depend on the resource's last access, 
+        // layout transitions in the same barrier. outside of render passes
+        void ResourceBarrier(std::span<const ResourceAccess> accesses);
+        // one dependency info with the stages of each barrier instead of their union
+        void ResourceBarrierSync2(
+            std::span<const vk::BufferMemoryBarrier> buffer_barriers, std::span<const BarrierStages> buffer_barrier_stages,
+            std::span<const vk::ImageMemoryBarrier> image_barriers, std::span<const BarrierStages> image_barrier_stages) const;
+        // resources written to resource_manager's descriptors that stages use
+        static void AddResourceAccesses(
+            std::vector<ResourceAccess>& accesses, const DnmGLLite::ResourceManager* resource_manager, vk::PipelineStageFlags stages);
+        // no barriers inside render passes, indirect reads are synchronized by BeginRendering
+        void CheckPassIndirectBuffer(const DnmGLLite::Buffer* buffer) const;
         
+        // binds sets that differ from the bound ones, or every set after the first one the layout change disturbs
+        void BindDescriptorSets(
+            vk::PipelineBindPoint bind_point, 
+            vk::PipelineLayout layout, 
+            std::span<const vk::DescriptorSetLayout> set_layouts, 
+            std::span<const vk::PushConstantRange> push_constant_ranges,
+            std::span<const vk::DescriptorSet> sets);
+        void BindVkPipeline(vk::PipelineBindPoint bind_point, vk::Pipeline pipeline);
+        void PushConstants(
+            vk::PipelineLayout layout, 
+            std::span<const vk::PushConstantRange> push_constant_ranges, 
+            vk::ShaderStageFlags stages, 
+            uint32_t offset, 
+            uint32_t size, 
+            const void* ptr);
+
+        // every begin goes through here, nothing is bound in a newly begun command buffer
+        void BeginVk(const vk::CommandBufferBeginInfo& begin_info);
+
         void AddImageForDeferTranslateLayout(Vulkan::Image *image);
         void ProcressDeferTranslateImageLayout();
         
         vk::CommandBuffer command_buffer;
+        // pool of the frame this command buffer belongs to
+        vk::CommandPool m_command_pool;
+        bool m_frame_staging;
+        // continues the primary's render pass, only draw state, pipelines of the pass and draws are recorded in it
+        bool m_secondary;
+        // async compute on a family without graphics, set by Context. graphics stages of earlier uses are dropped from barriers,
+        // the graphics queue's work is ordered by semaphores
+        bool m_compute_only = false;
+
+        // owned by the frame, each one has its own pool
+        std::vector<CommandBuffer*> m_secondaries{};
+        // set by BeginSecondary, cleared by ExecuteSecondaries
+        bool m_secondary_recorded = false;
+
+        // between BeginRendering and EndRendering, its render pass or formats are the target of BindPipeline and secondaries
+        const Vulkan::GraphicsPipeline* m_render_pipeline{};
+        std::vector<const DnmGLLite::GraphicsPipeline*> m_pass_pipelines{};
+        std::vector<const DnmGLLite::Buffer*> m_pass_indirect_buffers{};
 
-        ResourceAccessInfo m_buffer_resource_access_info;
-        ResourceAccessInfo m_image_resource_access_info;
+        // owned by the frame, each scope uses two queries
+        vk::QueryPool m_timestamp_query_pool = VK_NULL_HANDLE;
+        uint32_t m_timestamp_query_count{};
+        std::vector<TimestampScope> m_timestamp_scopes{};
+        // indices in m_timestamp_scopes, UINT32_MAX for scopes that didn't fit the pool
+        std::vector<uint32_t> m_open_timestamp_scopes{};
 
         //procress in BindPipeline or begin pipeline
         std::unordered_set<Vulkan::Image *> m_defer_translate_image_layout;
 
+        BoundState m_bound_state{};
+        // every set bound since begin, secondaries' sets added by ExecuteSecondaries, taken by the submit
+        std::vector<vk::DescriptorSet> m_used_sets{};
+
         friend Vulkan::Context;
     };
     
     inline void CommandBuffer::Begin() {
         command_buffer.reset();
-        command_buffer.begin(vk::CommandBufferBeginInfo{});
+        BeginVk(vk::CommandBufferBeginInfo{});
+    }
+
+    inline void CommandBuffer::BeginVk(const vk::CommandBufferBeginInfo& begin_info) {
+        command_buffer.begin(begin_info);
+        m_bound_state = {};
+        m_used_sets.clear();
     }
     
     inline void CommandBuffer::End() {
+        while (!m_open_timestamp_scopes.empty()) {
+            EndScope();
+        }
         ProcressDeferTranslateImageLayout();
         command_buffer.end();
-
-        m_buffer_resource_access_info = {};
-        m_image_resource_access_info = {};
     }
     
     inline void CommandBuffer::Draw(uint32_t vertex_count, uint32_t instance_count) {
+        if (m_bound_state.bind_points[0].pipeline_pending) return;
         command_buffer.draw(vertex_count, instance_count, 0, 0);
     }
     
     inline void CommandBuffer::DrawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t vertex_offset) {
+        if (m_bound_state.bind_points[0].pipeline_pending) return;
         command_buffer.drawIndexed(index_count, instance_count, 0, vertex_offset, 0);
     }
 
     inline void CommandBuffer::SetViewport(Float2 extent, Float2 offset, float min_depth, float max_depth) {
-        command_buffer.setViewport(0, {vk::Viewport{}
-            .setMinDepth(max_depth).setMinDepth(max_depth)
+        const auto viewport = vk::Viewport{}
+            .setMinDepth(min_depth).setMaxDepth(max_depth)
             .setHeight(extent.y).setWidth(extent.x)
-            .setX(offset.x).setY(offset.y)
-        });
+            .setX(offset.x).setY(offset.y);
+        if (m_bound_state.viewport == viewport) return;
+
+        command_buffer.setViewport(0, viewport);
+        m_bound_state.viewport = viewport;
     }
 
     inline void CommandBuffer::SetScissor(Uint2 extent, Uint2 offset) {
-        command_buffer.setScissor(0, { vk::Rect2D{}
+        const auto scissor = vk::Rect2D{}
             .setOffset({static_cast<int32_t>(offset.x), static_cast<int32_t>(offset.y)})
-            .setExtent({extent.x, extent.y})
-        });
+            .setExtent({extent.x, extent.y});
+        if (m_bound_state.scissor == scissor) return;
+
+        command_buffer.setScissor(0, scissor);
+        m_bound_state.scissor = scissor;
     }
 
     inline void CommandBuffer::TransferImageLayout(
@@ -138,55 +300,41 @@ namespace DnmGLLite::Vulkan {
         }
     }
 
-    inline void CommandBuffer::ResourceBarrier(ResourceAccessInfo buffer_access_info, ResourceAccessInfo image_access_info) {
-        const bool need_buffer_barrier = 
-            (m_buffer_resource_access_info.access == ResourceAccessBit::eRead 
-            || m_buffer_resource_access_info.access.None())
-            && buffer_access_info.access.Any();
-
-        const bool need_image_barrier = 
-            (m_image_resource_access_info.access == ResourceAccessBit::eRead 
-            || m_image_resource_access_info.access.None())
-            && image_access_info.access.Any();
+    inline void CommandBuffer::BeginScope(std::string_view name) {
+        DnmGLLiteAssert(!m_secondary, "scopes can't be recorded in secondaries, begin them in the primary around the render pass")
+        if (!m_timestamp_query_pool) return;
 
-        if (!(need_buffer_barrier || need_image_barrier))
+        const auto begin_query = static_cast<uint32_t>(m_timestamp_scopes.size() * 2);
+        if (begin_query + 2 > m_timestamp_query_count) {
+            m_open_timestamp_scopes.emplace_back(UINT32_MAX);
             return;
+        }
 
-        vk::MemoryBarrier barrier{};
-        vk::PipelineStageFlags src_pipeline_flags{};
-        vk::PipelineStageFlags dst_pipeline_flags{};
+        m_open_timestamp_scopes.emplace_back(static_cast<uint32_t>(m_timestamp_scopes.size()));
+        m_timestamp_scopes.emplace_back(
+            std::string(name), 
+            static_cast<uint32_t>(m_open_timestamp_scopes.size() - 1), 
+            begin_query, 
+            begin_query + 1);
 
-        // no barrier for buffer
-        if (need_buffer_barrier) {
-            barrier.srcAccessMask |= m_buffer_resource_access_info.GetVkAccessFlags();
-            barrier.dstAccessMask |= buffer_access_info.GetVkAccessFlags();
-            src_pipeline_flags |= m_buffer_resource_access_info.stages;
-            dst_pipeline_flags |= buffer_access_info.stages;
-        }
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_timestamp_query_pool, begin_query);
+    }
 
-        // no barrier for image
-        if ((m_image_resource_access_info.access == ResourceAccessBit::eRead 
-            || m_image_resource_access_info.access.None())
-            && image_access_info.access.Any()) {
-            barrier.srcAccessMask |= m_image_resource_access_info.GetVkAccessFlags();
-            barrier.dstAccessMask |= image_access_info.GetVkAccessFlags();
-            src_pipeline_flags |= m_image_resource_access_info.stages;
-            dst_pipeline_flags |= image_access_info.stages;
-        }
+    inline void CommandBuffer::EndScope() {
+        DnmGLLiteAssert(!m_secondary, "scopes can't be recorded in secondaries, begin them in the primary around the render pass")
+        if (m_open_timestamp_scopes.empty()) return;
 
-        command_buffer.pipelineBarrier(
-                src_pipeline_flags,
-                dst_pipeline_flags,
-                {}, 
-                barrier,
-                {}, 
-                {});
+        const auto scope_index = m_open_timestamp_scopes.back();
+        m_open_timestamp_scopes.pop_back();
+        if (scope_index == UINT32_MAX) return;
 
-        m_buffer_resource_access_info = buffer_access_info;
-        m_image_resource_access_info = image_access_info;
+        command_buffer.writeTimestamp(
+            vk::PipelineStageFlagBits::eBottomOfPipe, m_timestamp_query_pool, m_timestamp_scopes[scope_index].end_query);
     }
 
     inline void CommandBuffer::Dispatch(uint32_t x, uint32_t y, uint32_t z) {
+        DnmGLLiteAssert(!m_secondary, "dispatches can't be recorded in secondaries, they continue a render pass")
+        if (m_bound_state.bind_points[1].pipeline_pending) return;
         command_buffer.dispatch(x, y, z);
     }
 
@@ -16,8 +16,14 @@
 #endif
 
 #include <functional>
+#include <array>
+#include <bit>
+#include <algorithm>
+#include <ranges>
 #include <vector>
+#include <unordered_map>
 #include <cstdint>
+#include <cstddef>
 
 typedef struct VmaAllocator_T* VmaAllocator;
 typedef struct VmaAllocation_T* VmaAllocation;
@@ -76,6 +82,10 @@ namespace DnmGLLite::Vulkan {
                 if (access.Has(ResourceAccessBit::eRead))
                     out |= vk::AccessFlagBits::eShaderRead;
             }
+            if (stages & vk::PipelineStageFlagBits::eDrawIndirect) {
+                if (access.Has(ResourceAccessBit::eRead))
+                    out |= vk::AccessFlagBits::eIndirectCommandRead;
+            }
             if (stages & vk::PipelineStageFlagBits::eTransfer) {
                 if (access.Has(ResourceAccessBit::eWrite))
                     out |= vk::AccessFlagBits::eTransferWrite;
@@ -86,12 +96,51 @@ namespace DnmGLLite::Vulkan {
         }
     };
 
+    // last write of a buffer or image in recorded commands and the reads that already see it.
+    // layout transitions count as writes with no access
+    struct ResourceState {
+        vk::PipelineStageFlags write_stages{};
+        vk::AccessFlags write_access{};
+        vk::PipelineStageFlags read_stages{};
+        vk::AccessFlags read_access{};
+        // every earlier use is waited for these by a CommandBuffer::Barrier, accesses in them only need layout transitions
+        vk::PipelineStageFlags synchronized_stages{};
+        vk::AccessFlags synchronized_access{};
+    };
+
+    // every mipmap level and array layer, aspect is ignored by image layout tracking
+    constexpr vk::ImageSubresourceRange whole_image_range{{}, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+
+    inline bool IsWriteAccess(vk::AccessFlags access) {
+        return static_cast<bool>(access & (vk::AccessFlagBits::eShaderWrite
+            | vk::AccessFlagBits::eColorAttachmentWrite
+            | vk::AccessFlagBits::eDepthStencilAttachmentWrite
+            | vk::AccessFlagBits::eTransferWrite
+            | vk::AccessFlagBits::eHostWrite
+            | vk::AccessFlagBits::eMemoryWrite));
+    }
+
     class CommandBuffer;
     class Shader;
     class Buffer;
     class Image;
     class Sampler;
     class RenderPass;
+    class GraphicsPipeline;
+    class UploadEngine;
+    class PipelineCache;
+    class ShaderCache;
+    class DescriptorAllocator;
+    class BindlessTable;
+    struct DescriptorAllocation;
+
+    // query indices in the frame's timestamp query pool
+    struct TimestampScope {
+        std::string name;
+        uint32_t depth;
+        uint32_t begin_query;
+        uint32_t end_query;
+    };
 
     // images must be this layout except for copy or transfer commands  
     inline vk::ImageLayout GetIdealImageLayout(DnmGLLite::ImageUsageFlags flags) {
@@ -150,8 +199,9 @@ namespace DnmGLLite::Vulkan {
         struct InternalBufferResource {
             vk::Buffer buffer;
             vk::DescriptorType type;
-            uint32_t offset;
-            uint32_t size;
+            vk::DeviceSize offset;
+            // VK_WHOLE_SIZE for the rest of the buffer
+            vk::DeviceSize size;
 
             vk::DescriptorSet set;
             uint32_t binding;
@@ -176,6 +226,13 @@ namespace DnmGLLite::Vulkan {
             uint32_t array_element;
         };
 
+        // every descriptor of set written with update_template, data in the template's entry layout
+        struct InternalTemplateUpdate {
+            vk::DescriptorSet set;
+            vk::DescriptorUpdateTemplate update_template;
+            std::vector<std::byte> data;
+        };
+
         struct SupportedFeatures {
             bool uniform_buffer_update_after_bind : 1 = false;
             bool storage_buffer_update_after_bind : 1 = false;
@@ -187,6 +244,12 @@ namespace DnmGLLite::Vulkan {
             bool memory_priority : 1 = false;
             bool sync2 : 1 = false;
             bool anisotropy : 1 = false;
+            bool timeline_semaphore : 1 = false;
+            bool draw_indirect_count : 1 = false;
+            // pipelines only know attachment formats, no render pass and framebuffer objects
+            bool dynamic_rendering : 1 = false;
+            // runtime arrays, partially bound and non uniform indexing with every update after bind above but uniform
+            bool bindless : 1 = false;
 
             //chatgpt
             operator std::string() {
@@ -200,6 +263,10 @@ namespace DnmGLLite::Vulkan {
                 s += "memory_priority: " + std::string(memory_priority ? "true" : "false") + "\n";
                 s += "sync2: " + std::string(sync2 ? "true" : "false") + "\n";
                 s += "anisotropy: " + std::string(anisotropy ? "true" : "false") + "\n";
+                s += "timeline_semaphore: " + std::string(timeline_semaphore ? "true" : "false") + "\n";
+                s += "draw_indirect_count: " + std::string(draw_indirect_count ? "true" : "false") + "\n";
+                s += "dynamic_rendering: " + std::string(dynamic_rendering ? "true" : "false") + "\n";
+                s += "bindless: " + std::string(bindless ? "true" : "false") + "\n";
                 s += "\n";
                 return s;
             }
@@ -209,6 +276,61 @@ namespace DnmGLLite::Vulkan {
             vk::QueueFlags queue_flags;
             uint32_t timestamp_valid_bits;
             uint32_t queue_family;
+            // same as queue_family if there is no transfer only family
+            uint32_t transfer_queue_family;
+            uint32_t transfer_queue_index;
+            // same as queue_family if there is no compute family without graphics
+            uint32_t compute_queue_family;
+            uint32_t compute_queue_index;
+        };
+
+        // last value of each timeline that can use a released resource, reused once all of them completed.
+        // upload_value is the upload engine's batch serial
+        struct RetireTicket {
+            // indexed by QueueType
+            std::array<uint64_t, 2> queue_values{};
+            uint64_t upload_value{};
+
+            [[nodiscard]] bool IsCompleteAt(const RetireTicket& completed) const {
+                return queue_values[0] <= completed.queue_values[0] 
+                    && queue_values[1] <= completed.queue_values[1] 
+                    && upload_value <= completed.upload_value;
+            }
+        };
+
+        // handle of any non-dispatchable type, allocation only for buffers and images
+        struct DeletedObject {
+            vk::ObjectType type;
+            uint64_t handle;
+            VmaAllocation allocation;
+            RetireTicket ticket;
+        };
+
+        struct StagingAllocation {
+            const Vulkan::Buffer* buffer;
+            uint32_t offset;
+            uint8_t* mapped_ptr;
+        };
+
+        // also used for async compute submits, render_finished_semaphore is waited by the next graphics submit
+        struct FrameData {
+            vk::Fence fence = VK_NULL_HANDLE;
+            vk::Semaphore acquire_next_image_semaphore = VK_NULL_HANDLE;
+            vk::Semaphore render_finished_semaphore = VK_NULL_HANDLE;
+            vk::CommandPool command_pool = VK_NULL_HANDLE;
+            CommandBuffer* command_buffer{};
+            // one pool per secondary, pools can't be used from multiple threads
+            std::vector<vk::CommandPool> secondary_command_pools{};
+            std::vector<CommandBuffer*> secondary_command_buffers{};
+            // ticket value of the last submit, used when timeline semaphores not supported
+            uint64_t ticket_value{};
+            // persistently mapped, bump allocated while recording, reset when fence signaled
+            Vulkan::Buffer* staging_buffer{};
+            uint32_t staging_offset{};
+            // VK_NULL_HANDLE if timestamps not supported or disabled, reset at the start of recording
+            vk::QueryPool timestamp_query_pool = VK_NULL_HANDLE;
+            // scopes of the last submit, resolved when the frame is reused
+            std::vector<TimestampScope> timestamp_scopes{};
         };
     public:
         Context();
@@ -220,32 +342,70 @@ namespace DnmGLLite::Vulkan {
 
         void Init(const ContextDesc&) override;
 
-        void ExecuteCommands(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) override;
-        void Render(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) override;
+        GpuTicket ExecuteCommands(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) override;
+        GpuTicket Render(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) override;
         void WaitForGPU() override;
-        void Vsync(bool v) override { ReCreateSwapchain({m_swapchain_properties.extent.width, m_swapchain_properties.extent.height}, v); }
+
+        GpuTicket ExecuteComputeAsync(const std::function<bool(DnmGLLite::CommandBuffer*)>& func, GpuTicket wait_ticket = {}) override;
+
+        [[nodiscard]] bool IsTicketComplete(uint64_t value, QueueType queue) override;
+        bool WaitTicket(uint64_t value, QueueType queue, uint64_t timeout_ns) override;
+        void ResumeOnTicketComplete(uint64_t value, QueueType queue, std::coroutine_handle<> handle) override;
+        void PollTickets() override;
+        void Vsync(bool v) override { 
+            if (IsHeadless()) return;
+            ReCreateSwapchain({m_swapchain_properties.extent.width, m_swapchain_properties.extent.height}, v); 
+        }
         
         [[nodiscard]] std::unique_ptr<DnmGLLite::Buffer> CreateBuffer(const DnmGLLite::BufferDesc&) noexcept override;
         [[nodiscard]] std::unique_ptr<DnmGLLite::Image> CreateImage(const DnmGLLite::ImageDesc&) noexcept override;
+        // one allocation sized for the biggest image, separate allocations if memory types don't overlap
+        [[nodiscard]] std::vector<std::unique_ptr<DnmGLLite::Image>> CreateAliasedImages(std::span<const DnmGLLite::ImageDesc>) noexcept override;
         [[nodiscard]] std::unique_ptr<DnmGLLite::Sampler> CreateSampler(const DnmGLLite::SamplerDesc&) noexcept override;
         [[nodiscard]] std::unique_ptr<DnmGLLite::Shader> CreateShader(const std::filesystem::path&) noexcept override;
         [[nodiscard]] std::unique_ptr<DnmGLLite::ResourceManager> CreateResourceManager(std::span<const DnmGLLite::Shader*>) noexcept override;
         [[nodiscard]] std::unique_ptr<DnmGLLite::ComputePipeline> CreateComputePipeline(const DnmGLLite::ComputePipelineDesc&) noexcept override;
         [[nodiscard]] std::unique_ptr<DnmGLLite::GraphicsPipeline> CreateGraphicsPipeline(const DnmGLLite::GraphicsPipelineDesc&) noexcept override;
+        // compiled by the pipeline cache's workers
+        [[nodiscard]] std::unique_ptr<DnmGLLite::ComputePipeline> CreateComputePipelineAsync(const DnmGLLite::ComputePipelineDesc&) noexcept override;
+        [[nodiscard]] std::unique_ptr<DnmGLLite::GraphicsPipeline> CreateGraphicsPipelineAsync(const DnmGLLite::GraphicsPipelineDesc&) noexcept override;
+        [[nodiscard]] DnmGLLite::Image* GetRenderTargetImage() const noexcept override;
+        [[nodiscard]] std::span<const GpuScopeTiming> GetGpuScopeTimings() const noexcept override { return m_gpu_scope_timings; }
+
+        void UploadDataAsync(const DnmGLLite::Buffer* buffer, const void* data, uint32_t size, uint32_t offset) override;
+        void UploadDataAsync(DnmGLLite::Image* image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset) override;
 
         [[nodiscard]] auto GetInstance() const { return m_instance; }
         [[nodiscard]] auto GetSurface() const { return m_surface; }
         [[nodiscard]] auto GetDevice() const { return m_device; }
         [[nodiscard]] auto GetPhysicalDevice() const { return m_physical_device; }
         [[nodiscard]] auto GetQueue() const { return m_queue; }
+        [[nodiscard]] auto GetTransferQueue() const { return m_transfer_queue; }
+        [[nodiscard]] auto GetComputeQueue() const { return m_compute_queue; }
+        // empty if all queues are in the same family. storage resources shared between these families
+        [[nodiscard]] std::span<const uint32_t> GetConcurrentQueueFamilies() const { return m_concurrent_queue_families; }
         [[nodiscard]] auto GetSwapchain() const { return m_swapchain; }
-        [[nodiscard]] auto GetCommandPool() const { return m_command_pool; }
-        [[nodiscard]] auto GetDescriptorPool() const { return m_descriptor_pool; }
+        [[nodiscard]] auto GetCommandPool() const { return m_frames[m_frame_index].command_pool; }
+        [[nodiscard]] DescriptorAllocator& GetDescriptorAllocator() const { return *m_descriptor_allocator; }
+        // nullptr if ContextDesc::bindless is false or device doesn't support it
+        [[nodiscard]] BindlessTable* GetBindlessTable() const { return m_bindless_table; }
+        [[nodiscard]] vk::PipelineCache GetPipelineCache() const;
+        [[nodiscard]] ShaderCache& GetShaderCache() const { return *m_shader_cache; }
         [[nodiscard]] const auto& GetSwapchainImages() const { return m_swapchain_images; }
         [[nodiscard]] const auto& GetSwapchainImageViews() const { return m_swapchain_image_views; }
         [[nodiscard]] auto* GetVmaAllocator() const { return m_vma_allocator; }
         [[nodiscard]] auto GetSwapchainProperties() const { return m_swapchain_properties; }
         [[nodiscard]] auto GetImageIndex() const { return m_image_index; }
+        // no surface and swapchain, presenting pipelines render into m_offscreen_images
+        [[nodiscard]] bool IsHeadless() const { return m_surface == VK_NULL_HANDLE; }
+        // headless only, image presenting pipelines render into this frame. tracked like user attachments
+        [[nodiscard]] Vulkan::Image* GetOffscreenImage() const { return m_offscreen_images[m_image_index].get(); }
+        // final layout of presenting render passes
+        [[nodiscard]] vk::ImageLayout GetPresentImageLayout() const { 
+            return IsHeadless() ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::ePresentSrcKHR; 
+        }
+        [[nodiscard]] auto GetFrameIndex() const { return m_frame_index; }
+        [[nodiscard]] uint32_t GetFramesInFlight() const { return m_frames.size(); }
         [[nodiscard]] auto GetEmptySetLayout() const { return m_empty_set_layout; }
         [[nodiscard]] auto GetEmptySet() const { return m_empty_set; }
         [[nodiscard]] const auto& GetDispatcher() const { return dispatcher; }
@@ -255,18 +415,47 @@ namespace DnmGLLite::Vulkan {
         [[nodiscard]]auto GetSupportedFeatures() const { return supported_features; }
         [[nodiscard]]auto GetDeviceFeatures() const { return device_features; }
 
-        void DeleteObject(const std::function<void(vk::Device device, VmaAllocator allocator)>& delete_func) {
-            defer_vulkan_obj_delete.emplace_back(std::move(delete_func));
+        // destroyed after gpu completes every submit that can use handle, see GetRetireTicket
+        template <typename T>
+        void DeleteObject(T handle, VmaAllocation allocation = nullptr) {
+            if (!handle) return;
+            m_deleted_objects.emplace_back(
+                T::objectType, 
+                std::bit_cast<uint64_t>(static_cast<typename T::CType>(handle)),
+                allocation, 
+                GetRetireTicket());
+        }
+
+        // memory without a buffer or image of its own, freed after every object using it is destroyed
+        void DeleteAllocation(VmaAllocation allocation) {
+            m_deleted_objects.emplace_back(vk::ObjectType::eDeviceMemory, 0, allocation, GetRetireTicket());
         }
 
+        // next graphics submit, the compute submit being recorded or the last one, 
+        // the recording upload batch or the last flushed one. objects released now are unused after all of them
+        [[nodiscard]] RetireTicket GetRetireTicket() const;
+        [[nodiscard]] RetireTicket GetCompletedRetireTicket();
+
+        // sets returned to their pool after gpu completes every submit that can use them, same as DeleteObject
+        void FreeDescriptorSets(DescriptorAllocation&& allocation);
+
         ContextState GetContextState();
+        // from staging buffer of the recording frame, std::nullopt if it doesn't fit.
+        // offset is a multiple of alignment, see Image::GetCopyAlignment for image copies
+        [[nodiscard]] std::optional<StagingAllocation> AllocateStaging(uint32_t size, uint32_t alignment);
+        // true if any submitted frame still executing
+        bool IsAnyFrameInFlight() const;
         Vulkan::CommandBuffer* GetCommandBufferIfRecording();
         //just for new created images
         void DeferImageLayoutTransfer(const InternalImageLayoutTranslation& res);
+        // removes pending transition of image, returns false if there is none
+        bool TakeDeferredImageLayoutTransfer(vk::Image image);
 
         void DeferResourceUpdate(const std::span<const InternalBufferResource>& res);
         void DeferResourceUpdate(const std::span<const InternalImageResource>& res);
         void DeferResourceUpdate(const std::span<const InternalTextureResource>& res);
+        // replaces earlier deferred updates of the set, the template writes all of its descriptors
+        void DeferResourceUpdate(InternalTemplateUpdate&& update);
 
         void ProcessResource(
             const Context::InternalBufferResource& res, vk::DescriptorBufferInfo& info, vk::WriteDescriptorSet& write);
@@ -275,21 +464,64 @@ namespace DnmGLLite::Vulkan {
         void ProcessResource(
             const Context::InternalTextureResource& res, vk::DescriptorImageInfo& info, vk::WriteDescriptorSet& write);
     private:
-        std::vector<std::function<void(vk::Device device, VmaAllocator allocator)>> defer_vulkan_obj_delete;
+        // in release order, so values of each timeline never decrease
+        std::vector<DeletedObject> m_deleted_objects;
 
-        using InternalResource = std::variant<InternalBufferResource, InternalImageResource, InternalTextureResource>;
         //just for new created images
         std::vector<InternalImageLayoutTranslation> defer_image_layout_transfer_array;
-        std::vector<InternalResource> defer_resource_update;
+        // in call order, later writes to the same array element win
+        std::vector<InternalBufferResource> defer_buffer_updates;
+        std::vector<InternalImageResource> defer_image_updates;
+        std::vector<InternalTextureResource> defer_texture_updates;
+        // applied before the writes above, which are all later than them
+        std::vector<InternalTemplateUpdate> defer_template_updates;
         void ProcressImageLayoutTransfer();
         void ProcessResourceUpdates();
+        // ticket of the last submit on queue binding each set, ProcessResourceUpdates waits only them
+        void RecordDescriptorSetUse(CommandBuffer& command_buffer, QueueType queue, uint64_t ticket_value);
+        void DestroyObject(const DeletedObject& object);
+        // destroys objects retired until completed_ticket
+        void DeleteVulkanObjects(const RetireTicket& completed_ticket);
         void DeleteVulkanObjects();
 
+        FrameData& WaitForNextFrame();
+        void BeginFrameRecording(FrameData& frame);
+        // reads timestamps of the last submit of frame, fence must be signaled
+        void ResolveTimestamps(FrameData& frame);
+        GpuTicket SubmitFrame(FrameData& frame, const vk::SubmitInfo& submit_info);
+        struct TicketTimeline {
+            // signaled with ticket values, VK_NULL_HANDLE if timeline semaphores not supported
+            vk::Semaphore semaphore = VK_NULL_HANDLE;
+            uint64_t counter{};
+            uint64_t completed{};
+        };
+
+        struct TicketWaiter {
+            uint64_t value;
+            QueueType queue;
+            std::coroutine_handle<> handle;
+        };
+
+        uint64_t GetCompletedTicketValue(QueueType queue);
+        [[nodiscard]] TicketTimeline& GetTicketTimeline(QueueType queue) { return m_ticket_timelines[static_cast<uint32_t>(queue)]; }
+        [[nodiscard]] std::vector<FrameData>& GetQueueFrames(QueueType queue) { 
+            return queue == QueueType::eCompute ? m_compute_frames : m_frames; 
+        }
+        // makes graphics queue wait compute submits that no graphics submit waited yet
+        void WaitPendingComputeSemaphores();
+
         struct Dispatcher {
             constexpr uint32_t getVkHeaderVersion() const { return VK_HEADER_VERSION; }
             DECLARE_VK_FUNC(vkCreateDebugUtilsMessengerEXT);
             DECLARE_VK_FUNC(vkDestroyDebugUtilsMessengerEXT);
             DECLARE_VK_FUNC(vkCmdPipelineBarrier2KHR);
+            DECLARE_VK_FUNC(vkGetSemaphoreCounterValueKHR);
+            DECLARE_VK_FUNC(vkWaitSemaphoresKHR);
+            DECLARE_VK_FUNC(vkCmdDrawIndirectCountKHR);
+            DECLARE_VK_FUNC(vkCmdDrawIndexedIndirectCountKHR);
+            // loaded in CreateDevice, only with SupportedFeatures::dynamic_rendering
+            DECLARE_VK_FUNC(vkCmdBeginRenderingKHR);
+            DECLARE_VK_FUNC(vkCmdEndRenderingKHR);
         } dispatcher;
 
         SupportedFeatures supported_features;
@@ -299,10 +531,12 @@ namespace DnmGLLite::Vulkan {
         void CreateDebugMessenger();
         void CreateSurface(const WindowHandle&);
         void CreateDevice();
-        void CreateCommandPool();
-        void CreateDescriptorPool();
+        void CreateFrames(uint32_t frames_in_flight, uint32_t secondary_count);
         void CreateSwapchain(Uint2 extent, bool Vsync);
+        void CreateOffscreenImages(Uint2 extent);
         void CreateVmaAllocator();
+        void CreateStagingBuffers(uint32_t size);
+        void CreateTimestampQueryPools(uint32_t scope_count);
         void CreatePlaceholders();
         
         vk::Instance m_instance = VK_NULL_HANDLE;
@@ -311,31 +545,69 @@ namespace DnmGLLite::Vulkan {
         vk::PhysicalDevice m_physical_device = VK_NULL_HANDLE;
         vk::Device m_device = VK_NULL_HANDLE;
         vk::Queue m_queue = VK_NULL_HANDLE;
-        vk::Fence m_fence = VK_NULL_HANDLE;
-        vk::Semaphore m_acquire_next_image_semaphore = VK_NULL_HANDLE;
-        vk::Semaphore m_render_finished_semaphore = VK_NULL_HANDLE;
-        vk::CommandPool m_command_pool = VK_NULL_HANDLE;
+        vk::Queue m_transfer_queue = VK_NULL_HANDLE;
+        vk::Queue m_compute_queue = VK_NULL_HANDLE;
+        std::vector<uint32_t> m_concurrent_queue_families{};
+        UploadEngine* m_upload_engine{};
+        PipelineCache* m_pipeline_cache{};
+        ShaderCache* m_shader_cache{};
+        DescriptorAllocator* m_descriptor_allocator{};
+        BindlessTable* m_bindless_table{};
+        std::vector<FrameData> m_frames{};
+        uint32_t m_frame_index{};
+        std::vector<FrameData> m_compute_frames{};
+        uint32_t m_compute_frame_index{};
+        // compute submits the next graphics submit waits
+        std::vector<vk::Semaphore> m_pending_compute_semaphores{};
+        // indexed by QueueType
+        std::array<TicketTimeline, 2> m_ticket_timelines{};
+        std::vector<TicketWaiter> m_ticket_waiters{};
+        // inside the function of ExecuteComputeAsync, objects released now can be used by its submit
+        bool m_compute_recording = false;
+        // indexed by QueueType, 0 if no submit on that queue used the set
+        std::unordered_map<VkDescriptorSet, std::array<uint64_t, 2>> m_descriptor_set_tickets{};
         uint32_t m_image_index{};
-        CommandBuffer* m_command_buffer;
+        // headless only, offscreen image of the last submitted Render
+        uint32_t m_last_render_image_index{};
         SwapchainProperties m_swapchain_properties;
         vk::SwapchainKHR m_swapchain = VK_NULL_HANDLE;
         std::vector<vk::Image> m_swapchain_images{};
         std::vector<vk::ImageView> m_swapchain_image_views{};
+        //headless only, one per frame in flight. views in m_swapchain_image_views owned by them
+        std::vector<std::unique_ptr<Vulkan::Image>> m_offscreen_images{};
         VmaAllocator m_vma_allocator = VK_NULL_HANDLE;
-        vk::DescriptorPool m_descriptor_pool;
         vk::DescriptorSetLayout m_empty_set_layout;
         vk::DescriptorSet m_empty_set;
         ContextState context_state = ContextState::eNone;
+        // nanoseconds per timestamp tick
+        float m_timestamp_period{};
+        std::vector<GpuScopeTiming> m_gpu_scope_timings{};
     };
 
     inline void Context::WaitForGPU() {
-        [[maybe_unused]] auto _ = m_device.waitForFences(m_fence, vk::True, 1'000'000'000);
-        m_device.resetFences(m_fence);
+        for (const auto& frame : m_frames) {
+            [[maybe_unused]] auto _ = m_device.waitForFences(frame.fence, vk::True, 1'000'000'000);
+        }
+        for (const auto& frame : m_compute_frames) {
+            [[maybe_unused]] auto _ = m_device.waitForFences(frame.fence, vk::True, 1'000'000'000);
+        }
+    }
+
+    inline bool Context::IsAnyFrameInFlight() const {
+        for (const auto& frame : m_frames) {
+            if (m_device.getFenceStatus(frame.fence) != vk::Result::eSuccess)
+                return true;
+        }
+        for (const auto& frame : m_compute_frames) {
+            if (m_device.getFenceStatus(frame.fence) != vk::Result::eSuccess)
+                return true;
+        }
+        return false;
     }
 
     inline ContextState Context::GetContextState() {
         if (context_state == ContextState::eCommandExecuting) {
-            if (m_device.getFenceStatus(m_fence) == vk::Result::eSuccess)
+            if (!IsAnyFrameInFlight())
                 context_state = ContextState::eNone;
         }
         return context_state;
@@ -343,7 +615,7 @@ namespace DnmGLLite::Vulkan {
 
     inline Vulkan::CommandBuffer* Context::GetCommandBufferIfRecording() {
         if (context_state == ContextState::eCommandBufferRecording) {
-            return m_command_buffer;
+            return m_frames[m_frame_index].command_buffer;
         }
         return nullptr;
     }
@@ -391,32 +663,39 @@ namespace DnmGLLite::Vulkan {
         defer_image_layout_transfer_array.emplace_back(res);
     }
 
+    inline bool Context::TakeDeferredImageLayoutTransfer(vk::Image image) {
+        return std::erase_if(defer_image_layout_transfer_array, [image] (const auto& res) { return res.image == image; });
+    }
+
     inline void Context::DeferResourceUpdate(const std::span<const InternalBufferResource>& res) {
-        defer_resource_update.reserve(res.size());
-        for (const auto& r : res) {
-            defer_resource_update.emplace_back(r);
-        }
+        defer_buffer_updates.insert(defer_buffer_updates.end(), res.begin(), res.end());
     }
 
     inline void Context::DeferResourceUpdate(const std::span<const InternalImageResource>& res) {
-        defer_resource_update.reserve(res.size());
-        for (const auto& r : res) {
-            defer_resource_update.emplace_back(r);
-        }
+        defer_image_updates.insert(defer_image_updates.end(), res.begin(), res.end());
     }
 
     inline void Context::DeferResourceUpdate(const std::span<const InternalTextureResource>& res) {
-        defer_resource_update.reserve(res.size());
-        for (const auto& r : res) {
-            defer_resource_update.emplace_back(r);
+        defer_texture_updates.insert(defer_texture_updates.end(), res.begin(), res.end());
+    }
+
+    inline void Context::DeleteVulkanObjects(const RetireTicket& completed_ticket) {
+        const auto it = std::ranges::find_if(m_deleted_objects, [&completed_ticket] (const DeletedObject& object) {
+            return !object.ticket.IsCompleteAt(completed_ticket);
+        });
+
+        for (const auto& object : std::ranges::subrange(m_deleted_objects.begin(), it)) {
+            DestroyObject(object);
         }
+        m_deleted_objects.erase(m_deleted_objects.begin(), it);
     }
 
+    // destroys everything, gpu must be idle
     inline void Context::DeleteVulkanObjects() {
-        for (const auto& delete_func : defer_vulkan_obj_delete) {
-            delete_func(m_device, m_vma_allocator);
+        for (const auto& object : m_deleted_objects) {
+            DestroyObject(object);
         }
-        defer_vulkan_obj_delete.resize(0);
+        m_deleted_objects.resize(0);
     }
 }
 
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "DnmGLLite/Vulkan/Context.hpp"
+
+namespace DnmGLLite::Vulkan {
+    struct DescriptorAllocation {
+        std::vector<vk::DescriptorSet> sets{};
+        uint32_t pool_index{};
+        // total of every set, returned to the pool when freed
+        std::vector<vk::DescriptorPoolSize> descriptor_counts{};
+    };
+
+    // pools with free descriptor set flag, a new pool created when none of them fits the allocation.
+    // freed sets returned to their pool once the gpu completes the ticket they're retired with. not thread safe
+    class DescriptorAllocator {
+    public:
+        DescriptorAllocator(Vulkan::Context& context);
+        ~DescriptorAllocator();
+
+        // descriptor_counts is the total of every layout per type
+        [[nodiscard]] DescriptorAllocation Allocate(
+            std::span<const vk::DescriptorSetLayout> layouts, std::span<const vk::DescriptorPoolSize> descriptor_counts);
+        // sets must not be used by submits after ticket
+        void Free(DescriptorAllocation&& allocation, const Context::RetireTicket& ticket);
+        // frees sets retired until completed_ticket
+        void Collect(const Context::RetireTicket& completed_ticket);
+
+        [[nodiscard]] uint32_t GetPoolCount() const { return m_pools.size(); }
+    private:
+        struct Pool {
+            vk::DescriptorPool pool = VK_NULL_HANDLE;
+            uint32_t free_set_count{};
+            std::vector<vk::DescriptorPoolSize> free_descriptor_counts{};
+            // allocation failed even though counts fit, skipped until a set is freed
+            bool fragmented = false;
+        };
+
+        struct RetiredAllocation {
+            DescriptorAllocation allocation;
+            Context::RetireTicket ticket;
+        };
+
+        [[nodiscard]] static bool Fits(const Pool& pool, uint32_t set_count, std::span<const vk::DescriptorPoolSize> descriptor_counts);
+        // sized for the allocation if it doesn't fit the default pool sizes
+        Pool& CreatePool(uint32_t set_count, std::span<const vk::DescriptorPoolSize> descriptor_counts);
+
+        Vulkan::Context& m_context;
+        std::vector<Pool> m_pools{};
+        // in release order, so values of each timeline never decrease
+        std::vector<RetiredAllocation> m_retired_allocations{};
+    };
+}
\ No newline at end of file
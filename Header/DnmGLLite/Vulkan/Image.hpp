@@ -2,27 +2,55 @@
 
 #include "DnmGLLite/Vulkan/Context.hpp"
 #include <map>
+#include <memory>
 
 namespace DnmGLLite::Vulkan {
     class Image final : public DnmGLLite::Image {
     public:
-        Image(Vulkan::Context& context, const DnmGLLite::ImageDesc& desc);
+        // aliased_allocation binds the image to memory shared with other images, see Context::CreateAliasedImages
+        Image(Vulkan::Context& context, const DnmGLLite::ImageDesc& desc, std::shared_ptr<VmaAllocation_T> aliased_allocation = {});
         ~Image();
 
         [[nodiscard]] auto GetImage() const { return m_image; }
-        [[nodiscard]] auto GetImageLayout() const { return m_image_layout; }
+        // layout of the whole image, subresources only differ inside commands that change part of it
+        [[nodiscard]] auto GetImageLayout() const { return m_subresource_layouts.front(); }
+        [[nodiscard]] auto GetImageLayout(uint32_t mipmap, uint32_t layer) const { return m_subresource_layouts[mipmap * GetLayerCount() + layer]; }
+        // every subresource of range is in layout, aspect ignored
+        [[nodiscard]] bool HasImageLayout(const vk::ImageSubresourceRange& range, vk::ImageLayout layout) const;
+        [[nodiscard]] uint32_t GetLayerCount() const { return m_desc.type == ImageType::e2D ? m_desc.extent.z : 1; }
         [[nodiscard]] auto GetAspect() const { return m_aspect; }
         [[nodiscard]] auto *GetAllocation() const { return m_allocation; }
+        // concurrent for storage images when async compute has its own queue family
+        [[nodiscard]] auto GetSharingMode() const { return m_sharing_mode; }
+
+        // buffer offset alignment of copies to and from the image, multiple of the texel block size and 4
+        [[nodiscard]] uint32_t GetCopyAlignment() const;
 
         [[nodiscard]] auto GetIdealImageLayout() const { return Vulkan::GetIdealImageLayout(m_desc.usage_flags); }
         [[nodiscard]] vk::ImageView CreateGetImageView(const ImageSubresource& subresource);
+
+        [[nodiscard]] static vk::MemoryRequirements GetMemoryRequirements(Vulkan::Context& context, const DnmGLLite::ImageDesc& desc);
     private:
+        void SetImageLayout(vk::ImageLayout layout) { std::ranges::fill(m_subresource_layouts, layout); }
+        // barriers for every subresource of range, one per block of subresources in the same layout.
+        // new_layout eUndefined keeps layouts
+        void AddLayoutBarriers(std::vector<vk::ImageMemoryBarrier>& barriers, const vk::ImageSubresourceRange& range, 
+            vk::ImageLayout new_layout, vk::AccessFlags src_access, vk::AccessFlags dst_access);
+
         vk::Image m_image;
-        vk::ImageLayout m_image_layout = vk::ImageLayout::ePreinitialized;
+        // per mipmap level then array layer
+        std::vector<vk::ImageLayout> m_subresource_layouts;
         vk::ImageAspectFlags m_aspect;
-        VmaAllocation m_allocation;
+        // null for images aliasing memory, m_aliased_allocation holds it instead
+        VmaAllocation m_allocation = nullptr;
+        // freed after the last image aliasing it is destroyed
+        std::shared_ptr<VmaAllocation_T> m_aliased_allocation{};
+        vk::SharingMode m_sharing_mode = vk::SharingMode::eExclusive;
+        ResourceState m_state{};
 
         std::map<ImageSubresource, vk::ImageView> m_image_views;
+        friend Vulkan::Context;
         friend Vulkan::CommandBuffer;
+        friend Vulkan::UploadEngine;
     };
 }
\ No newline at end of file
@@ -6,9 +6,13 @@
 namespace DnmGLLite::Vulkan {
     class GraphicsPipeline final : public DnmGLLite::GraphicsPipeline {
     public:
-        GraphicsPipeline(Vulkan::Context& context, const DnmGLLite::GraphicsPipelineDesc& desc) noexcept;
+        // with async, vk::Pipeline is created by Compile later
+        GraphicsPipeline(Vulkan::Context& context, const DnmGLLite::GraphicsPipelineDesc& desc, bool async = false) noexcept;
         ~GraphicsPipeline() noexcept;
 
+        // creates vk::Pipeline, thread safe with recording commands of other pipelines
+        void Compile() noexcept;
+
         void SetAttachments(
             std::span<const DnmGLLite::RenderAttachment> attachments, 
             const std::optional<DnmGLLite::RenderAttachment> &depth_stencil_attachment,
@@ -27,10 +31,31 @@ namespace DnmGLLite::Vulkan {
         [[nodiscard]] auto GetFramebuffer() const { 
             return m_desc.presenting ? m_swapchain_framebuffers[VulkanContext->GetImageIndex()] : m_framebuffer;
         }
+
+        // dynamic rendering, attachments in framebuffer order: colors, msaa colors then depth stencil.
+        // presenting pipelines have the current swapchain image view as color
+        [[nodiscard]] std::vector<vk::ImageView> GetAttachmentViews() const;
+        // images the pipeline creates for msaa colors and depth stencil without user image
+        [[nodiscard]] auto& GetInternalAttachments() const { return m_attachments; }
+        [[nodiscard]] auto& GetColorFormats() const { return m_color_formats; }
+        [[nodiscard]] auto GetDepthFormat() const { return m_has_depth_attachment ? ToVk(m_desc.depth_format) : vk::Format::eUndefined; }
+        [[nodiscard]] auto GetStencilFormat() const { 
+            return !m_has_stencil_attachment ? vk::Format::eUndefined 
+                : m_has_depth_attachment ? ToVk(m_desc.depth_format) : ToVk(m_desc.stencil_format); 
+        }
         
         [[nodiscard]] auto GetDstSets() const { return std::span(m_dst_sets); }
-        [[nodiscard]] auto GetBufferResourceAccessInfo() const { return m_buffer_resource_access_info; }
-        [[nodiscard]] auto GetImageResourceAccessInfo() const { return m_image_resource_access_info; }
+        // pipeline layout compatibility, see CommandBuffer::BindDescriptorSets
+        [[nodiscard]] auto GetSetLayouts() const { return std::span(m_set_layouts); }
+        [[nodiscard]] auto GetPushConstantRanges() const { return std::span(m_push_constant_ranges); }
+
+        // same attachment formats and sample count, so usable in other's render pass
+        [[nodiscard]] bool IsRenderCompatible(const Vulkan::GraphicsPipeline& other) const {
+            return m_color_formats == other.m_color_formats
+                && GetDepthFormat() == other.GetDepthFormat()
+                && GetStencilFormat() == other.GetStencilFormat()
+                && m_desc.msaa == other.m_desc.msaa;
+        }
     private:
         void CreateRenderpass() noexcept;
         void DestroyFramebuffer() const noexcept;
@@ -45,7 +70,13 @@ namespace DnmGLLite::Vulkan {
         vk::Framebuffer m_framebuffer;
         vk::Extent2D m_render_area;
 
+        std::vector<vk::Format> m_color_formats{};
+        // framebuffer attachments when rendering dynamically
+        std::vector<vk::ImageView> m_attachment_views{};
+
         std::vector<vk::DescriptorSet> m_dst_sets{};
+        std::vector<vk::DescriptorSetLayout> m_set_layouts{};
+        std::vector<vk::PushConstantRange> m_push_constant_ranges{};
 
         std::vector<Vulkan::Image *> m_user_color_attachments{}; 
         Vulkan::Image *m_user_depth_stencil_attachment{};
@@ -53,72 +84,62 @@ namespace DnmGLLite::Vulkan {
         std::vector<std::unique_ptr<Vulkan::Image>> m_attachments{};
         std::vector<vk::Framebuffer> m_swapchain_framebuffers{};
 
-        ResourceAccessInfo m_buffer_resource_access_info{};
-        ResourceAccessInfo m_image_resource_access_info{};
-
         bool m_has_depth_attachment : 1{};
         bool m_has_stencil_attachment : 1{};
     };
 
     class ComputePipeline final : public DnmGLLite::ComputePipeline  {
     public:
-        ComputePipeline(Vulkan::Context& context, const DnmGLLite::ComputePipelineDesc& desc) noexcept;
+        // with async, vk::Pipeline is created by Compile later
+        ComputePipeline(Vulkan::Context& context, const DnmGLLite::ComputePipelineDesc& desc, bool async = false) noexcept;
         ~ComputePipeline() noexcept;
+
+        void Compile() noexcept;
         
         [[nodiscard]] auto GetPipeline() const { return m_pipeline; }
         [[nodiscard]] auto GetPipelineLayout() const { return m_pipeline_layout; }
         [[nodiscard]] auto GetDstSets() const { return std::span(m_dst_sets); }
-
-        [[nodiscard]] auto GetBufferResourceAccessInfo() const { return m_buffer_resource_access_info; }
-        [[nodiscard]] auto GetImageResourceAccessInfo() const { return m_image_resource_access_info; }
+        [[nodiscard]] auto GetSetLayouts() const { return std::span(m_set_layouts); }
+        [[nodiscard]] auto GetPushConstantRanges() const { return std::span(m_push_constant_ranges); }
     private:
         std::vector<vk::DescriptorSet> m_dst_sets{};
+        std::vector<vk::DescriptorSetLayout> m_set_layouts{};
+        std::vector<vk::PushConstantRange> m_push_constant_ranges{};
 
-        ResourceAccessInfo m_buffer_resource_access_info{};
-        ResourceAccessInfo m_image_resource_access_info{};
-        
         vk::Pipeline m_pipeline;
         vk::PipelineLayout m_pipeline_layout;
     };
 
     inline ComputePipeline::~ComputePipeline() noexcept {
-        VulkanContext->DeleteObject(
-            [
-                pipeline = m_pipeline, 
-                pipeline_layout = m_pipeline_layout
-            ] (vk::Device device, [[maybe_unused]] VmaAllocator allocator) noexcept -> void {
-                device.destroy(pipeline_layout);
-                device.destroy(pipeline);
-            });
+        // compile task still uses the pipeline
+        m_ready.wait(false);
+        VulkanContext->DeleteObject(m_pipeline_layout);
+        VulkanContext->DeleteObject(m_pipeline);
     }
 
     inline GraphicsPipeline::~GraphicsPipeline() noexcept {
-        VulkanContext->DeleteObject(
-            [
-                pipeline = m_pipeline, 
-                pipeline_layout = m_pipeline_layout,
-                renderpass = m_renderpass,
-                framebuffer = m_framebuffer,
-                swapchain_framebuffers = m_swapchain_framebuffers
-            ] (vk::Device device, [[maybe_unused]] VmaAllocator allocator) noexcept -> void {
-                device.destroy(pipeline_layout);
-                device.destroy(pipeline);
-                device.destroy(renderpass);
-                device.destroy(framebuffer);
-                for (const auto swapchain_framebuffer : swapchain_framebuffers)
-                    device.destroy(swapchain_framebuffer);
-            });
+        // compile task still uses the pipeline
+        m_ready.wait(false);
+        VulkanContext->DeleteObject(m_pipeline_layout);
+        VulkanContext->DeleteObject(m_pipeline);
+        VulkanContext->DeleteObject(m_renderpass);
+        VulkanContext->DeleteObject(m_framebuffer);
+        for (const auto swapchain_framebuffer : m_swapchain_framebuffers)
+            VulkanContext->DeleteObject(swapchain_framebuffer);
+    }
+
+    inline std::vector<vk::ImageView> GraphicsPipeline::GetAttachmentViews() const {
+        auto views = m_attachment_views;
+        if (m_desc.presenting) {
+            views[0] = VulkanContext->GetSwapchainImageViews()[VulkanContext->GetImageIndex()];
+        }
+        return views;
     }
 
     inline void GraphicsPipeline::DestroyFramebuffer() const noexcept {
         if (m_framebuffer == VK_NULL_HANDLE) {
             return;
         }
-        VulkanContext->DeleteObject(
-            [
-                framebuffer = m_framebuffer
-            ] (vk::Device device, [[maybe_unused]] VmaAllocator allocator) -> void {
-                device.destroy(framebuffer);
-            });
+        VulkanContext->DeleteObject(m_framebuffer);
     }
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DnmGLLite/Vulkan/Context.hpp"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace DnmGLLite::Vulkan {
+    // VkPipelineCache saved to path, descs of pipelines created in a run saved to path.manifest.
+    // empty path keeps the cache only in memory
+    class PipelineCache {
+    public:
+        PipelineCache(Vulkan::Context& context, const std::filesystem::path& path);
+        ~PipelineCache();
+
+        [[nodiscard]] vk::PipelineCache GetPipelineCache() const { return m_pipeline_cache; }
+
+        // thread safe
+        void Record(const DnmGLLite::GraphicsPipelineDesc& desc);
+        void Record(const DnmGLLite::ComputePipelineDesc& desc);
+
+        // compiles pipelines of the last run's manifest in parallel, created objects destroyed after
+        void WarmUp();
+        void Save();
+
+        // runs task on a worker thread, workers started on first use. thread safe
+        void Submit(std::function<void()> task);
+    private:
+        // runs tasks until stopped and no task is left
+        void WorkerLoop(std::stop_token stop_token);
+        // empty if file doesn't exist or was saved by another device or driver
+        [[nodiscard]] std::vector<uint8_t> LoadCacheData() const;
+        void LoadManifest();
+
+        [[nodiscard]] std::filesystem::path GetManifestPath() const { return m_path.string() + ".manifest"; }
+
+        Vulkan::Context& m_context;
+        std::filesystem::path m_path;
+        vk::PipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+
+        // entries of the last run, cleared by WarmUp
+        std::vector<std::string> m_warm_up_entries{};
+
+        std::mutex m_manifest_mutex{};
+        // one serialized desc per entry
+        std::set<std::string> m_manifest{};
+
+        std::mutex m_task_mutex{};
+        std::condition_variable_any m_task_condition{};
+        std::deque<std::function<void()>> m_tasks{};
+        // last member, joined before the others are destroyed
+        std::vector<std::jthread> m_workers{};
+    };
+}
@@ -1,16 +1,29 @@
 #pragma once
 
 #include "DnmGLLite/Vulkan/Context.hpp"
+#include "DnmGLLite/Vulkan/DescriptorAllocator.hpp"
+#include <map>
 
 namespace DnmGLLite::Vulkan {
     class ResourceManager final : public DnmGLLite::ResourceManager {
     public:
-        ResourceManager(DnmGLLite::Vulkan::Context& context, std::span<const DnmGLLite::Shader *> shaders);
+        // buffer or image written to a descriptor, stages and access of the binding in every shader using it
+        struct TrackedResource {
+            Vulkan::Buffer* buffer;
+            Vulkan::Image* image;
+            vk::PipelineStageFlags stages;
+            vk::AccessFlags access;
+        };
+
+        // without sets only layouts created, for pipelines that are never bound (pipeline cache warm up)
+        ResourceManager(DnmGLLite::Vulkan::Context& context, std::span<const DnmGLLite::Shader *> shaders, bool allocate_sets = true);
         ~ResourceManager();
 
         void SetResourceAsBuffer(std::span<const BufferResource> update_resource) override;
         void SetResourceAsImage(std::span<const ImageResource> update_resource) override;
         void SetResourceAsTexture(std::span<const TextureResource> update_resource) override;
+        // with the set's update template, deferred like SetResourceAs* when sets may be in use
+        void SetResources(uint32_t set, std::span<const DescriptorResource> resources) override;
 
         constexpr void BindSets(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout pipeline_layout) noexcept;
 
@@ -18,21 +31,71 @@ namespace DnmGLLite::Vulkan {
         [[nodiscard]] constexpr std::span<const vk::DescriptorSetLayout> GetDescriptorLayouts() const noexcept { return m_dst_set_layouts; }
         [[nodiscard]] std::vector<vk::DescriptorSet> GetDescriptorSets(std::span<const Vulkan::Shader *> shaders) const noexcept;
         [[nodiscard]] constexpr std::span<const vk::DescriptorSet> GetDescriptorSets() const noexcept { return m_sets; }
+        // bindless table resources aren't tracked
+        [[nodiscard]] const auto& GetTrackedResources() const noexcept { return m_tracked_resources; }
     private:
+        struct DescriptorSlot {
+            uint32_t set;
+            uint32_t binding;
+            uint32_t array_element;
+
+            auto operator<=>(const DescriptorSlot&) const = default;
+        };
+
+        struct BindingAccess {
+            vk::PipelineStageFlags stages;
+            vk::AccessFlags access;
+        };
+
+        // replaces the resource of the slot, ignored for bindings no shader uses
+        void TrackResource(uint32_t set, uint32_t binding, uint32_t array_element, Vulkan::Buffer* buffer, Vulkan::Image* image);
+        struct TemplateDescriptor {
+            uint32_t binding;
+            uint32_t array_element;
+            vk::DescriptorType type;
+        };
+
+        // VK_NULL_HANDLE for the bindless table, empty sets and sets with descriptor types SetResources doesn't write
+        struct SetUpdateTemplate {
+            vk::DescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+            // in template data order
+            std::vector<TemplateDescriptor> descriptors{};
+        };
+
+        // template data element, stride of every entry
+        union TemplateDescriptorInfo {
+            VkDescriptorBufferInfo buffer;
+            VkDescriptorImageInfo image;
+        };
+
+        void CreateUpdateTemplate(uint32_t set, std::span<const vk::DescriptorSetLayoutBinding> bindings);
+
+        // bindless table set first if enabled
         std::vector<vk::DescriptorSet> m_sets;
+        DescriptorAllocation m_allocation;
         std::vector<vk::DescriptorSetLayout> m_dst_set_layouts;
+        // indexed by set
+        std::vector<SetUpdateTemplate> m_update_templates;
+        std::vector<TemplateDescriptorInfo> m_template_data;
 
         vk::DescriptorSet m_placeholder_set;
+
+        // keyed by set and binding
+        std::map<std::pair<uint32_t, uint32_t>, BindingAccess> m_binding_accesses;
+        std::map<DescriptorSlot, TrackedResource> m_tracked_resources;
     };
 
     inline ResourceManager::~ResourceManager() {
-        const auto dst_set_layouts = std::move(m_dst_set_layouts);
-        VulkanContext->DeleteObject(
-            [dst_set_layouts] (vk::Device device, [[maybe_unused]] VmaAllocator allocator) -> void {
-                for (auto set_layout: dst_set_layouts) {
-                    device.destroy(set_layout);
-                }
-            });
+        VulkanContext->FreeDescriptorSets(std::move(m_allocation));
+        // host only, not used by the gpu
+        for (const auto& update_template : m_update_templates) {
+            if (update_template.update_template) VulkanContext->GetDevice().destroy(update_template.update_template);
+        }
+        // layout of the bindless table isn't owned
+        const auto* bindless_table = VulkanContext->GetBindlessTable();
+        for (const auto set_layout : m_dst_set_layouts | std::views::drop(bindless_table ? 1 : 0)) {
+            VulkanContext->DeleteObject(set_layout);
+        }
     }
 
     inline constexpr void ResourceManager::BindSets(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout pipeline_layout) noexcept {
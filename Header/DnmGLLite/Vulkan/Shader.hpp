@@ -1,13 +1,17 @@
 #pragma once
 
 #include "DnmGLLite/Vulkan/Context.hpp"
+#include <map>
+#include <memory>
 
 namespace DnmGLLite::Vulkan {
-    class Shader final : public DnmGLLite::Shader {
+    struct ShaderReflection {
         struct BindingInfo {
             uint32_t binding;
             uint32_t descriptor_count;
             vk::DescriptorType type;
+            // storage buffers and images written by the shader
+            bool writable;
         };
 
         struct DescriptorSetInfo {
@@ -19,32 +23,75 @@ namespace DnmGLLite::Vulkan {
             uint32_t size;
             uint32_t offset;
         };
+
+        std::vector<DescriptorSetInfo> descriptor_sets;
+        std::optional<PushConstant> push_constant;
+        // sorted
+        std::vector<uint32_t> specialization_constant_ids;
+
+        ResourceAccessInfo buffer_resource_access_info{};
+        ResourceAccessInfo image_resource_access_info{};
+        vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eAll;
+    };
+
+    // shared by every shader created from the same spir-v
+    struct ShaderData {
+        ShaderData(Vulkan::Context& context, vk::ShaderModule shader_module, const ShaderReflection& reflection)
+            : context(context), shader_module(shader_module), reflection(reflection) {}
+        ~ShaderData() {
+            context.DeleteObject(shader_module);
+        }
+
+        Vulkan::Context& context;
+        vk::ShaderModule shader_module;
+        ShaderReflection reflection;
+    };
+
+    // deduplicates shader modules by content hash, reflection of every seen shader saved to path.
+    // empty path keeps reflections only in memory
+    class ShaderCache {
+    public:
+        ShaderCache(Vulkan::Context& context, const std::filesystem::path& path);
+        ~ShaderCache();
+
+        [[nodiscard]] std::shared_ptr<const ShaderData> GetShaderData(std::span<const uint32_t> code);
+        void Save();
+    private:
+        struct Key {
+            uint64_t hash;
+            uint64_t size;
+
+            auto operator<=>(const Key&) const = default;
+        };
+
+        void Load();
+
+        Vulkan::Context& m_context;
+        std::filesystem::path m_path;
+
+        std::map<Key, std::weak_ptr<const ShaderData>> m_shaders{};
+        std::map<Key, ShaderReflection> m_reflections{};
+        // reflections added since load
+        bool m_modified = false;
+    };
+
+    class Shader final : public DnmGLLite::Shader {
     public:
         Shader(Vulkan::Context& context, const std::filesystem::path& path);
-        ~Shader() {
-            const auto shader_module = m_shader_module;
-            VulkanContext->DeleteObject(
-                [shader_module] (vk::Device device, [[maybe_unused]] VmaAllocator allocator) -> void {
-                    device.destroy(shader_module);
-                });
-        }
+        ~Shader() = default;
 
-        [[nodiscard]] vk::ShaderStageFlagBits GetStage() const { return m_stage; }
-        [[nodiscard]] vk::ShaderModule GetShaderModule() const { return m_shader_module; }
+        [[nodiscard]] vk::ShaderStageFlagBits GetStage() const { return m_data->reflection.stage; }
+        [[nodiscard]] vk::ShaderModule GetShaderModule() const { return m_data->shader_module; }
 
-        [[nodiscard]] const auto& GetDescriptorSets() const { return m_descriptor_sets; }
-        [[nodiscard]] const auto& GetPushConstants() const { return m_push_constant; }
+        [[nodiscard]] const auto& GetDescriptorSets() const { return m_data->reflection.descriptor_sets; }
+        [[nodiscard]] const auto& GetPushConstants() const { return m_data->reflection.push_constant; }
+        [[nodiscard]] bool HasSpecializationConstant(uint32_t id) const {
+            return std::ranges::binary_search(m_data->reflection.specialization_constant_ids, id);
+        }
 
-        [[nodiscard]] auto GetBufferResourceAccessInfo() const { return m_buffer_resource_access_info; }
-        [[nodiscard]] auto GetImageResourceAccessInfo() const { return m_image_resource_access_info; }
+        [[nodiscard]] auto GetBufferResourceAccessInfo() const { return m_data->reflection.buffer_resource_access_info; }
+        [[nodiscard]] auto GetImageResourceAccessInfo() const { return m_data->reflection.image_resource_access_info; }
     private:
-        vk::ShaderModule m_shader_module{ VK_NULL_HANDLE };
-        
-        std::vector<DescriptorSetInfo> m_descriptor_sets;
-        std::optional<PushConstant> m_push_constant;
-        
-        ResourceAccessInfo m_buffer_resource_access_info{};
-        ResourceAccessInfo m_image_resource_access_info{};
-        vk::ShaderStageFlagBits m_stage = vk::ShaderStageFlagBits::eAll;
+        std::shared_ptr<const ShaderData> m_data;
     };
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "DnmGLLite/Vulkan/Context.hpp"
+#include <unordered_set>
+
+namespace DnmGLLite::Vulkan {
+    // records copies on the transfer queue, graphics queue acquires them at the start of the next frame.
+    // meant for new or streamed in resources, gpu must not use them in frames in flight.
+    // with different queue families, content outside of the uploaded range is undefined
+    class UploadEngine {
+    public:
+        UploadEngine(Vulkan::Context& context, uint32_t staging_buffer_size);
+        ~UploadEngine();
+
+        void UploadData(const Vulkan::Buffer* buffer, const void* data, uint32_t size, uint32_t offset);
+        void UploadData(Vulkan::Image* image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset);
+
+        // submits recorded copies, called before graphics frame recording
+        void Flush();
+        // acquire barriers of flushed copies, recorded at the start of graphics frame
+        void RecordAcquire(vk::CommandBuffer command_buffer) const;
+        // VK_NULL_HANDLE if no flushed copies waiting for graphics submit
+        [[nodiscard]] vk::Semaphore GetWaitSemaphore() const;
+        // flushed copies acquired by submitted graphics frame
+        void OnGraphicsSubmit();
+
+        // serial of the recording batch, or of the last flushed one if none is recording
+        [[nodiscard]] uint64_t GetRetireValue() const { return m_submitted_serial + m_recording; }
+        // serial of the last batch whose copies completed
+        [[nodiscard]] uint64_t GetCompletedValue();
+
+        [[nodiscard]] bool HasOwnershipTransfer() const { return m_transfer_queue_family != m_graphics_queue_family; }
+    private:
+        struct Batch {
+            vk::CommandPool command_pool = VK_NULL_HANDLE;
+            vk::CommandBuffer command_buffer = VK_NULL_HANDLE;
+            vk::Fence fence = VK_NULL_HANDLE;
+            vk::Semaphore semaphore = VK_NULL_HANDLE;
+            Vulkan::Buffer* staging_buffer{};
+            uint32_t staging_offset{};
+            // copies too big for staging_buffer, deleted once fence signals
+            std::vector<Vulkan::Buffer*> overflow_buffers{};
+            // 0 until flushed, increases with every flush
+            uint64_t serial{};
+        };
+
+        Batch& GetRecordingBatch();
+        static void DeleteOverflowBuffers(Batch& batch);
+        // buffer and offset of the copy source, offset is a multiple of alignment
+        std::pair<vk::Buffer, uint32_t> WriteStaging(Batch& batch, const void* data, uint32_t size, uint32_t alignment);
+        void AddReleaseBarrier(const Vulkan::Buffer* buffer);
+        void AddReleaseBarrier(Vulkan::Image* image, vk::ImageLayout new_layout);
+
+        Vulkan::Context& m_context;
+        uint32_t m_graphics_queue_family;
+        uint32_t m_transfer_queue_family;
+        vk::Queue m_transfer_queue;
+
+        std::vector<Batch> m_batches{};
+        uint32_t m_batch_index{};
+        uint32_t m_submitted_batch_index{};
+        bool m_recording = false;
+        bool m_waiting_acquire = false;
+        uint64_t m_submitted_serial{};
+        uint64_t m_completed_serial{};
+
+        // resources touched by the recording batch
+        std::unordered_set<const void*> m_batch_resources{};
+        std::vector<vk::BufferMemoryBarrier> m_release_buffer_barriers{};
+        std::vector<vk::ImageMemoryBarrier> m_release_image_barriers{};
+        std::vector<vk::BufferMemoryBarrier> m_acquire_buffer_barriers{};
+        std::vector<vk::ImageMemoryBarrier> m_acquire_image_barriers{};
+    };
+
+    inline vk::Semaphore UploadEngine::GetWaitSemaphore() const {
+        return m_waiting_acquire ? m_batches[m_submitted_batch_index].semaphore : VK_NULL_HANDLE;
+    }
+}
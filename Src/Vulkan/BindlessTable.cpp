@@ -0,0 +1,173 @@
+#include "DnmGLLite/Vulkan/BindlessTable.hpp"
+
+namespace DnmGLLite::Vulkan {
+    BindlessTable::BindlessTable(Vulkan::Context& context, uint32_t buffer_count, uint32_t image_count, uint32_t sampler_count)
+        : m_context(context) {
+        const auto device = m_context.GetDevice();
+
+        vk::PhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing{};
+        vk::PhysicalDeviceProperties2 properties{};
+        properties.setPNext(&descriptor_indexing);
+        m_context.GetPhysicalDevice().getProperties2(&properties);
+
+        buffer_count = std::min({buffer_count,
+            descriptor_indexing.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            descriptor_indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+        // same index in both image arrays
+        image_count = std::min({image_count,
+            descriptor_indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+            descriptor_indexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            descriptor_indexing.maxDescriptorSetUpdateAfterBindStorageImages,
+            descriptor_indexing.maxPerStageDescriptorUpdateAfterBindStorageImages});
+        sampler_count = std::min({sampler_count,
+            descriptor_indexing.maxDescriptorSetUpdateAfterBindSamplers,
+            descriptor_indexing.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+        GetIndexAllocator(BindlessArray::eBuffer).count = buffer_count;
+        GetIndexAllocator(BindlessArray::eImage).count = image_count;
+        GetIndexAllocator(BindlessArray::eSampler).count = sampler_count;
+
+        const vk::DescriptorSetLayoutBinding bindings[] = {
+            {storage_buffer_binding, vk::DescriptorType::eStorageBuffer, buffer_count, vk::ShaderStageFlagBits::eAll},
+            {sampled_image_binding, vk::DescriptorType::eSampledImage, image_count, vk::ShaderStageFlagBits::eAll},
+            {storage_image_binding, vk::DescriptorType::eStorageImage, image_count, vk::ShaderStageFlagBits::eAll},
+            {sampler_binding, vk::DescriptorType::eSampler, sampler_count, vk::ShaderStageFlagBits::eAll},
+        };
+
+        const auto binding_flag = vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound;
+        const vk::DescriptorBindingFlags binding_flags[] = { binding_flag, binding_flag, binding_flag, binding_flag };
+
+        const auto binding_flags_info = vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT{}.setBindingFlags(binding_flags);
+
+        m_set_layout = device.createDescriptorSetLayout(
+            vk::DescriptorSetLayoutCreateInfo{}
+                .setPNext(&binding_flags_info)
+                .setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT)
+                .setBindings(bindings));
+
+        const vk::DescriptorPoolSize pool_sizes[] = {
+            {vk::DescriptorType::eStorageBuffer, buffer_count},
+            {vk::DescriptorType::eSampledImage, image_count},
+            {vk::DescriptorType::eStorageImage, image_count},
+            {vk::DescriptorType::eSampler, sampler_count},
+        };
+
+        m_pool = device.createDescriptorPool(
+            vk::DescriptorPoolCreateInfo{}
+                .setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT)
+                .setMaxSets(1)
+                .setPoolSizes(pool_sizes));
+
+        m_set = device.allocateDescriptorSets(
+            vk::DescriptorSetAllocateInfo{}
+                .setDescriptorPool(m_pool)
+                .setSetLayouts(m_set_layout))[0];
+    }
+
+    BindlessTable::~BindlessTable() {
+        const auto device = m_context.GetDevice();
+        device.destroy(m_pool);
+        device.destroy(m_set_layout);
+    }
+
+    uint32_t BindlessTable::AddBuffer(vk::Buffer buffer) {
+        const auto index = AllocateIndex(BindlessArray::eBuffer);
+        if (index == InvalidBindlessIndex) return index;
+
+        const auto buffer_info = vk::DescriptorBufferInfo{}
+            .setBuffer(buffer)
+            .setOffset(0)
+            .setRange(VK_WHOLE_SIZE);
+
+        m_context.GetDevice().updateDescriptorSets(
+            vk::WriteDescriptorSet{}
+                .setDstSet(m_set)
+                .setDstBinding(storage_buffer_binding)
+                .setDstArrayElement(index)
+                .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                .setBufferInfo(buffer_info), {});
+        return index;
+    }
+
+    uint32_t BindlessTable::AddImage(vk::ImageView image_view, vk::ImageLayout layout, bool sampled, bool storage) {
+        const auto index = AllocateIndex(BindlessArray::eImage);
+        if (index == InvalidBindlessIndex) return index;
+
+        const auto sampled_info = vk::DescriptorImageInfo{}
+            .setImageView(image_view)
+            .setImageLayout(layout);
+        const auto storage_info = vk::DescriptorImageInfo{}
+            .setImageView(image_view)
+            .setImageLayout(vk::ImageLayout::eGeneral);
+
+        std::vector<vk::WriteDescriptorSet> writes{};
+        if (sampled) {
+            writes.emplace_back(vk::WriteDescriptorSet{}
+                .setDstSet(m_set)
+                .setDstBinding(sampled_image_binding)
+                .setDstArrayElement(index)
+                .setDescriptorType(vk::DescriptorType::eSampledImage)
+                .setImageInfo(sampled_info));
+        }
+        if (storage) {
+            writes.emplace_back(vk::WriteDescriptorSet{}
+                .setDstSet(m_set)
+                .setDstBinding(storage_image_binding)
+                .setDstArrayElement(index)
+                .setDescriptorType(vk::DescriptorType::eStorageImage)
+                .setImageInfo(storage_info));
+        }
+
+        m_context.GetDevice().updateDescriptorSets(writes, {});
+        return index;
+    }
+
+    uint32_t BindlessTable::AddSampler(vk::Sampler sampler) {
+        const auto index = AllocateIndex(BindlessArray::eSampler);
+        if (index == InvalidBindlessIndex) return index;
+
+        const auto sampler_info = vk::DescriptorImageInfo{}.setSampler(sampler);
+
+        m_context.GetDevice().updateDescriptorSets(
+            vk::WriteDescriptorSet{}
+                .setDstSet(m_set)
+                .setDstBinding(sampler_binding)
+                .setDstArrayElement(index)
+                .setDescriptorType(vk::DescriptorType::eSampler)
+                .setImageInfo(sampler_info), {});
+        return index;
+    }
+
+    void BindlessTable::Remove(BindlessArray array, uint32_t index, const Context::RetireTicket& ticket) {
+        if (index == InvalidBindlessIndex) return;
+        m_retired_indices.emplace_back(array, index, ticket);
+    }
+
+    void BindlessTable::Collect(const Context::RetireTicket& completed_ticket) {
+        const auto it = std::ranges::find_if(m_retired_indices, [&completed_ticket] (const RetiredIndex& retired) {
+            return !retired.ticket.IsCompleteAt(completed_ticket);
+        });
+
+        // descriptors left as they are, partially bound arrays allow stale ones that shaders don't access
+        for (const auto& retired : std::ranges::subrange(m_retired_indices.begin(), it)) {
+            GetIndexAllocator(retired.array).free_indices.emplace_back(retired.index);
+        }
+        m_retired_indices.erase(m_retired_indices.begin(), it);
+    }
+
+    uint32_t BindlessTable::AllocateIndex(BindlessArray array) {
+        auto& allocator = GetIndexAllocator(array);
+        if (!allocator.free_indices.empty()) {
+            const auto index = allocator.free_indices.back();
+            allocator.free_indices.pop_back();
+            return index;
+        }
+        if (allocator.next < allocator.count) {
+            return allocator.next++;
+        }
+
+        m_context.Message(std::format("bindless array {} is full ({} descriptors)", static_cast<uint32_t>(array), allocator.count),
+            MessageType::eOutOfMemory);
+        return InvalidBindlessIndex;
+    }
+}
\ No newline at end of file
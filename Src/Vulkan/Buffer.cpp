@@ -1,4 +1,5 @@
 #include "DnmGLLite/Vulkan/Buffer.hpp"
+#include "DnmGLLite/Vulkan/BindlessTable.hpp"
 #include <vma/vk_mem_alloc.h>
 
 namespace DnmGLLite::Vulkan {
@@ -31,6 +32,15 @@ namespace DnmGLLite::Vulkan {
                                     | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
         buffer_create_info.sharingMode = VkSharingMode::VK_SHARING_MODE_EXCLUSIVE;
+
+        // compute queue can write it without ownership transfers
+        const auto concurrent_families = ctx.GetConcurrentQueueFamilies();
+        if (m_desc.buffer_flags.Has(BufferUsageBits::eStorage) && !concurrent_families.empty()) {
+            m_sharing_mode = vk::SharingMode::eConcurrent;
+            buffer_create_info.sharingMode = VkSharingMode::VK_SHARING_MODE_CONCURRENT;
+            buffer_create_info.queueFamilyIndexCount = static_cast<uint32_t>(concurrent_families.size());
+            buffer_create_info.pQueueFamilyIndices = concurrent_families.data();
+        }
         buffer_create_info.size = m_desc.size;
 
         VmaAllocationInfo alloc_info;
@@ -65,14 +75,16 @@ namespace DnmGLLite::Vulkan {
         }
         
         m_mapped_ptr = reinterpret_cast<uint8_t*>(alloc_info.pMappedData);
+
+        if (auto* bindless_table = ctx.GetBindlessTable(); bindless_table && m_desc.buffer_flags.Has(BufferUsageBits::eStorage)) {
+            m_bindless_index = bindless_table->AddBuffer(m_buffer);
+        }
     }
 
     Buffer::~Buffer() {
-        const auto buffer = m_buffer;
-        auto* allocation = m_allocation;
-        VulkanContext->DeleteObject(
-            [buffer, allocation] ([[maybe_unused]] vk::Device device, VmaAllocator allocator) -> void {
-                vmaDestroyBuffer(allocator, buffer, allocation);
-            });
+        if (auto* bindless_table = VulkanContext->GetBindlessTable()) {
+            bindless_table->Remove(BindlessArray::eBuffer, m_bindless_index, VulkanContext->GetRetireTicket());
+        }
+        VulkanContext->DeleteObject(m_buffer, m_allocation);
     }
 }
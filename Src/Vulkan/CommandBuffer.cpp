@@ -2,14 +2,59 @@
 #include "DnmGLLite/Vulkan/Pipeline.hpp"
 #include "DnmGLLite/Vulkan/Buffer.hpp"
 #include "DnmGLLite/Vulkan/Image.hpp"
+#include "DnmGLLite/Vulkan/ResourceManager.hpp"
 
 namespace DnmGLLite::Vulkan {
-    CommandBuffer::CommandBuffer(Vulkan::Context& context)
-        : DnmGLLite::CommandBuffer(context) {
+    struct UsageScope {
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags access;
+    };
+
+    static UsageScope GetVkUsageScope(ResourceUsage usage) {
+        const auto shader_stages = vk::PipelineStageFlagBits::eVertexShader 
+            | vk::PipelineStageFlagBits::eFragmentShader 
+            | vk::PipelineStageFlagBits::eComputeShader;
+
+        switch (usage) {
+            case ResourceUsage::eUnknown: 
+                return {vk::PipelineStageFlagBits::eAllCommands, vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite};
+            case ResourceUsage::eIndirectRead: 
+                return {vk::PipelineStageFlagBits::eDrawIndirect, vk::AccessFlagBits::eIndirectCommandRead};
+            case ResourceUsage::eVertexRead: 
+                return {vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead};
+            case ResourceUsage::eUniformRead: 
+                return {shader_stages, vk::AccessFlagBits::eUniformRead};
+            case ResourceUsage::eShaderRead: 
+                return {shader_stages, vk::AccessFlagBits::eShaderRead};
+            case ResourceUsage::eShaderWrite: 
+                return {shader_stages, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+            case ResourceUsage::eColorAttachment: 
+                return {vk::PipelineStageFlagBits::eColorAttachmentOutput, 
+                    vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite};
+            case ResourceUsage::eDepthStencilAttachment: 
+                return {vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, 
+                    vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite};
+            case ResourceUsage::eTransferRead: 
+                return {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead};
+            case ResourceUsage::eTransferWrite: 
+                return {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite};
+            case ResourceUsage::eHostRead: 
+                return {vk::PipelineStageFlagBits::eHost, vk::AccessFlagBits::eHostRead};
+        }
+        return {vk::PipelineStageFlagBits::eAllCommands, vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite};
+    }
+
+    static vk::ImageSubresourceRange GetVkSubresourceRange(const ImageSubresource& subresource) {
+        return {{}, subresource.base_mipmap, 1, subresource.base_layer, subresource.layer_count};
+    }
+
+    CommandBuffer::CommandBuffer(Vulkan::Context& context, vk::CommandPool command_pool, bool use_frame_staging, vk::CommandBufferLevel level)
+        : DnmGLLite::CommandBuffer(context), m_command_pool(command_pool), m_frame_staging(use_frame_staging),
+        m_secondary(level == vk::CommandBufferLevel::eSecondary) {
         vk::CommandBufferAllocateInfo alloc_descs;
         alloc_descs.setCommandBufferCount(1)
-                    .setCommandPool(context.GetCommandPool())
-                    .setLevel(vk::CommandBufferLevel::ePrimary);
+                    .setCommandPool(command_pool)
+                    .setLevel(level);
     
         command_buffer = context.GetDevice().allocateCommandBuffers(alloc_descs)[0];
     }
@@ -19,48 +64,124 @@ namespace DnmGLLite::Vulkan {
 
         ProcressDeferTranslateImageLayout();
 
-        command_buffer.bindDescriptorSets(
-                        vk::PipelineBindPoint::eCompute, 
-                        typed_pipeline->GetPipelineLayout(),
-                        0,
-                        typed_pipeline->GetDstSets(),
-                        {});
+        std::vector<ResourceAccess> accesses{};
+        AddResourceAccesses(accesses, typed_pipeline->GetDesc().resource_manager, vk::PipelineStageFlagBits::eComputeShader);
+        ResourceBarrier(accesses);
 
-        command_buffer.bindPipeline(
+        auto& bound = m_bound_state.bind_points[static_cast<uint32_t>(vk::PipelineBindPoint::eCompute)];
+        bound.pipeline_pending = !typed_pipeline->IsReady();
+        if (bound.pipeline_pending) return;
+
+        BindDescriptorSets(
             vk::PipelineBindPoint::eCompute, 
-            typed_pipeline->GetPipeline()
-        );
+            typed_pipeline->GetPipelineLayout(),
+            typed_pipeline->GetSetLayouts(),
+            typed_pipeline->GetPushConstantRanges(),
+            typed_pipeline->GetDstSets());
+        BindVkPipeline(vk::PipelineBindPoint::eCompute, typed_pipeline->GetPipeline());
     }
 
-    void CommandBuffer::CopyImageToBuffer(const DnmGLLite::ImageToBufferCopyDesc& desc) {
-        ResourceBarrier({
-                {},
-                ResourceAccessBit::eWrite,
-                vk::PipelineStageFlagBits::eTransfer
-            },
-            {
-                {},
-                ResourceAccessBit::eRead,
-                vk::PipelineStageFlagBits::eTransfer
+    void CommandBuffer::BindDescriptorSets(
+        vk::PipelineBindPoint bind_point, 
+        vk::PipelineLayout layout, 
+        std::span<const vk::DescriptorSetLayout> set_layouts, 
+        std::span<const vk::PushConstantRange> push_constant_ranges,
+        std::span<const vk::DescriptorSet> sets) {
+        auto& bound = m_bound_state.bind_points[static_cast<uint32_t>(bind_point)];
+
+        // sets stay bound through compatible layouts
+        uint32_t compatible_count{};
+        if (std::ranges::equal(bound.push_constant_ranges, push_constant_ranges)) {
+            const auto count = std::min(bound.set_layouts.size(), set_layouts.size());
+            while (compatible_count < count && bound.set_layouts[compatible_count] == set_layouts[compatible_count]) {
+                ++compatible_count;
             }
-        );
+        }
+        compatible_count = std::min<uint32_t>(compatible_count, bound.sets.size());
+
+        uint32_t first = 0;
+        while (first < compatible_count && bound.sets[first] == sets[first]) ++first;
+
+        // sets after the last different one stay bound only if the whole layout is compatible
+        uint32_t last = sets.size();
+        if (compatible_count == sets.size()) {
+            while (last > first && bound.sets[last - 1] == sets[last - 1]) --last;
+        }
+
+        if (first < last) {
+            command_buffer.bindDescriptorSets(bind_point, layout, first, sets.subspan(first, last - first), {});
+            m_used_sets.insert(m_used_sets.end(), sets.begin() + first, sets.begin() + last);
+        }
+
+        bound.set_layouts.assign(set_layouts.begin(), set_layouts.end());
+        bound.push_constant_ranges.assign(push_constant_ranges.begin(), push_constant_ranges.end());
+        bound.sets.assign(sets.begin(), sets.end());
+    }
+
+    void CommandBuffer::BindVkPipeline(vk::PipelineBindPoint bind_point, vk::Pipeline pipeline) {
+        auto& bound = m_bound_state.bind_points[static_cast<uint32_t>(bind_point)];
+        if (bound.pipeline == pipeline) return;
+
+        command_buffer.bindPipeline(bind_point, pipeline);
+        bound.pipeline = pipeline;
+    }
+
+    void CommandBuffer::PushConstants(
+        vk::PipelineLayout layout, 
+        std::span<const vk::PushConstantRange> push_constant_ranges, 
+        vk::ShaderStageFlags stages, 
+        uint32_t offset, 
+        uint32_t size, 
+        const void* ptr) {
+        auto& bound = m_bound_state;
+        const auto* bytes = static_cast<const std::byte*>(ptr);
+
+        // values pushed with layouts of other push constant ranges are undefined
+        if (!std::ranges::equal(bound.push_constant_ranges, push_constant_ranges)) {
+            bound.push_constant_ranges.assign(push_constant_ranges.begin(), push_constant_ranges.end());
+            bound.push_constant_valid.reset();
+        }
+
+        const bool cached = offset + size <= bound.push_constant_data.size();
+        if (cached) {
+            bool same = true;
+            for (uint32_t i = offset; i < offset + size && same; ++i) {
+                same = bound.push_constant_valid[i] && bound.push_constant_data[i] == bytes[i - offset];
+            }
+            if (same) return;
+        }
+
+        command_buffer.pushConstants(layout, stages, offset, size, ptr);
+
+        if (!cached) return;
+        std::copy_n(bytes, size, bound.push_constant_data.begin() + offset);
+        for (uint32_t i = offset; i < offset + size; ++i) {
+            bound.push_constant_valid.set(i);
+        }
+    }
 
+    void CommandBuffer::CopyImageToBuffer(const DnmGLLite::ImageToBufferCopyDesc& desc) {
         auto* typed_src_image = static_cast<Vulkan::Image *>(desc.src_image);
         const auto* typed_dst_buffer = static_cast<const Vulkan::Buffer *>(desc.dst_buffer);
-        
-        if (typed_src_image->GetImageLayout() != vk::ImageLayout::eTransferSrcOptimal) {
-            const TransferImageLayoutDesc transfer_image_layout {
-                .image = typed_src_image,
-                .new_image_layout = vk::ImageLayout::eTransferSrcOptimal,
-                .src_pipeline_stages = vk::PipelineStageFlagBits::eTopOfPipe,
-                .dst_pipeline_stages = vk::PipelineStageFlagBits::eTransfer,
-                .src_access = {},
-                .dst_access = vk::AccessFlagBits::eTransferRead,
-            };
 
-            TransferImageLayout({&transfer_image_layout, 1});
-            AddImageForDeferTranslateLayout(typed_src_image);
-        }
+        const ResourceAccess accesses[] = {
+            {
+                .buffer = nullptr,
+                .image = typed_src_image,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferRead,
+                .layout = vk::ImageLayout::eTransferSrcOptimal,
+                .range = GetVkSubresourceRange(desc.image_subresource),
+            },
+            {
+                .buffer = typed_dst_buffer,
+                .image = nullptr,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferWrite,
+            },
+        };
+        ResourceBarrier(accesses);
+        AddImageForDeferTranslateLayout(typed_src_image);
 
         const vk::BufferImageCopy buffer_image_copy {
             desc.buffer_offset,
@@ -78,54 +199,37 @@ namespace DnmGLLite::Vulkan {
 
         command_buffer.copyImageToBuffer(
             typed_src_image->GetImage(), 
-            typed_src_image->GetImageLayout(),
+            vk::ImageLayout::eTransferSrcOptimal,
             typed_dst_buffer->GetBuffer(),
             buffer_image_copy
         );
     }
 
     void CommandBuffer::CopyImageToImage(const DnmGLLite::ImageToImageCopyDesc& desc) {
-        ResourceBarrier({},
-            {
-                {},
-                ResourceAccessBit::eRead | ResourceAccessBit::eWrite,
-                vk::PipelineStageFlagBits::eTransfer
-            }
-        );
-
         auto* typed_src_image = static_cast<Vulkan::Image *>(desc.src_image);
         auto* typed_dst_image = static_cast<Vulkan::Image *>(desc.dst_image);
-        
-        // image layout translation
-        {
-            std::vector<TransferImageLayoutDesc> image_layout_translate{};
-            image_layout_translate.reserve(2);
-    
-            if (typed_src_image->GetImageLayout() != vk::ImageLayout::eTransferSrcOptimal) {
-                image_layout_translate.emplace_back(
-                    typed_src_image,
-                    vk::ImageLayout::eTransferSrcOptimal,
-                    vk::PipelineStageFlagBits::eTopOfPipe,
-                    vk::PipelineStageFlagBits::eTransfer,
-                    vk::AccessFlagBits{},
-                    vk::AccessFlagBits::eTransferRead
-                );
-            }
-            if (typed_dst_image->GetImageLayout() != vk::ImageLayout::eTransferDstOptimal) {
-                image_layout_translate.emplace_back(
-                    typed_dst_image,
-                    vk::ImageLayout::eTransferDstOptimal,
-                    vk::PipelineStageFlagBits::eTopOfPipe,
-                    vk::PipelineStageFlagBits::eTransfer,
-                    vk::AccessFlagBits{},
-                    vk::AccessFlagBits::eTransferWrite
-                );
-            }
-            TransferImageLayout(image_layout_translate);
 
-            AddImageForDeferTranslateLayout(typed_src_image);
-            AddImageForDeferTranslateLayout(typed_dst_image);
-        }
+        const ResourceAccess accesses[] = {
+            {
+                .buffer = nullptr,
+                .image = typed_src_image,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferRead,
+                .layout = vk::ImageLayout::eTransferSrcOptimal,
+                .range = GetVkSubresourceRange(desc.src_image_subresource),
+            },
+            {
+                .buffer = nullptr,
+                .image = typed_dst_image,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferWrite,
+                .layout = vk::ImageLayout::eTransferDstOptimal,
+                .range = GetVkSubresourceRange(desc.dst_image_subresource),
+            },
+        };
+        ResourceBarrier(accesses);
+        AddImageForDeferTranslateLayout(typed_src_image);
+        AddImageForDeferTranslateLayout(typed_dst_image);
         
         const vk::ImageCopy image_copy(
             vk::ImageSubresourceLayers(
@@ -155,17 +259,25 @@ namespace DnmGLLite::Vulkan {
     }
 
     void CommandBuffer::CopyBufferToBuffer(const DnmGLLite::BufferToBufferCopyDesc &desc) {
-        ResourceBarrier({
-                {},
-                ResourceAccessBit::eRead | ResourceAccessBit::eWrite,
-                vk::PipelineStageFlagBits::eTransfer
-            },
-            {}
-        );
-
         const auto *typed_src_buffer = static_cast<const Vulkan::Buffer *>(desc.src_buffer);
         const auto *typed_dst_buffer = static_cast<const Vulkan::Buffer *>(desc.dst_buffer);
 
+        const ResourceAccess accesses[] = {
+            {
+                .buffer = typed_src_buffer,
+                .image = nullptr,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferRead,
+            },
+            {
+                .buffer = typed_dst_buffer,
+                .image = nullptr,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferWrite,
+            },
+        };
+        ResourceBarrier(accesses);
+
         const vk::BufferCopy buffer_copy {
             desc.src_offset,
             desc.dst_offset,
@@ -179,36 +291,27 @@ namespace DnmGLLite::Vulkan {
     }
 
     void CommandBuffer::CopyBufferToImage(const DnmGLLite::BufferToImageCopyDesc& desc) {
-        ResourceBarrier(
-            {
-                {},
-                ResourceAccessBit::eRead,
-                vk::PipelineStageFlagBits::eTransfer
-            },
-            {
-                {},
-                ResourceAccessBit::eWrite,
-                vk::PipelineStageFlagBits::eTransfer
-            }
-        );
-
         const auto* typed_src_buffer = static_cast<const Vulkan::Buffer*>(desc.src_buffer);
         auto* typed_dst_image = static_cast<Vulkan::Image*>(desc.dst_image);
 
-        if (typed_dst_image->GetImageLayout() != vk::ImageLayout::eTransferDstOptimal) {
-            const TransferImageLayoutDesc transfer_image_layout {
+        const ResourceAccess accesses[] = {
+            {
+                .buffer = typed_src_buffer,
+                .image = nullptr,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferRead,
+            },
+            {
+                .buffer = nullptr,
                 .image = typed_dst_image,
-                .new_image_layout = vk::ImageLayout::eTransferDstOptimal,
-                .src_pipeline_stages = vk::PipelineStageFlagBits::eTopOfPipe,
-                .dst_pipeline_stages = vk::PipelineStageFlagBits::eTransfer,
-                .src_access = {},
-                .dst_access = vk::AccessFlagBits::eTransferWrite,
-            };
-
-            TransferImageLayout({&transfer_image_layout, 1});
-
-            AddImageForDeferTranslateLayout(typed_dst_image);
-        }
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferWrite,
+                .layout = vk::ImageLayout::eTransferDstOptimal,
+                .range = GetVkSubresourceRange(desc.image_subresource),
+            },
+        };
+        ResourceBarrier(accesses);
+        AddImageForDeferTranslateLayout(typed_dst_image);
 
         const vk::BufferImageCopy buffer_image_copy {
             desc.buffer_offset,
@@ -238,8 +341,9 @@ namespace DnmGLLite::Vulkan {
         uint32_t size, 
         const void *ptr) {
         const auto* typed_pipeline = static_cast<const GraphicsPipeline*>(pipeline);
-        command_buffer.pushConstants(
+        PushConstants(
             typed_pipeline->GetPipelineLayout(), 
+            typed_pipeline->GetPushConstantRanges(),
             static_cast<vk::ShaderStageFlags>((uint32_t)pipeline_stage),
             offset, 
             size, 
@@ -253,8 +357,9 @@ namespace DnmGLLite::Vulkan {
         uint32_t size, 
         const void *ptr) {
         const auto* typed_pipeline = static_cast<const Vulkan::ComputePipeline*>(pipeline);
-        command_buffer.pushConstants(
+        PushConstants(
             typed_pipeline->GetPipelineLayout(), 
+            typed_pipeline->GetPushConstantRanges(),
             static_cast<vk::ShaderStageFlags>((uint32_t)pipeline_stage), 
             offset, 
             size, 
@@ -263,25 +368,33 @@ namespace DnmGLLite::Vulkan {
 
     void CommandBuffer::TransferImageLayout(
         std::span<const TransferImageLayoutDesc> descs) const {
+        DnmGLLiteAssert(!m_secondary, "barriers can't be recorded in secondaries, they continue a render pass")
         std::vector<TransferImageLayoutNativeDesc> barriers{};
         barriers.reserve(descs.size());
+        std::vector<vk::ImageMemoryBarrier> layout_barriers{};
 
         for (const auto& desc : descs) {
-            if (desc.new_image_layout == desc.image->GetImageLayout()) {
+            if (desc.image->HasImageLayout(whole_image_range, desc.new_image_layout)) {
                 continue;
             }
-            barriers.emplace_back(
-                desc.image->GetImage(),
-                desc.image->GetAspect(),
-                desc.image->GetImageLayout(),
-                desc.new_image_layout,
-                desc.src_pipeline_stages,
-                desc.dst_pipeline_stages,
-                desc.src_access,
-                desc.dst_access
-            );
 
-            desc.image->m_image_layout = desc.new_image_layout;
+            // one per block of subresources in the same layout, also sets the new layout
+            layout_barriers.clear();
+            desc.image->AddLayoutBarriers(
+                layout_barriers, whole_image_range, desc.new_image_layout, desc.src_access, desc.dst_access);
+            for (const auto& barrier : layout_barriers) {
+                barriers.emplace_back(
+                    desc.image->GetImage(),
+                    desc.image->GetAspect(),
+                    barrier.oldLayout,
+                    barrier.newLayout,
+                    desc.src_pipeline_stages,
+                    desc.dst_pipeline_stages,
+                    desc.src_access,
+                    desc.dst_access,
+                    barrier.subresourceRange
+                );
+            }
         }
 
         TransferImageLayout(barriers);
@@ -289,9 +402,13 @@ namespace DnmGLLite::Vulkan {
 
     void CommandBuffer::TransferImageLayoutDefaultVk(
         std::span<const TransferImageLayoutNativeDesc> descs) const {
-        for (const auto& desc : descs) {
-            const vk::ImageMemoryBarrier barrier {
-                vk::ImageMemoryBarrier(
+        std::vector<vk::ImageMemoryBarrier> barriers;
+        barriers.reserve(descs.size());
+
+        // one pipelineBarrier per run of descs with the same stages, order kept
+        for (uint32_t i{}; i < descs.size(); ++i) {
+            const auto& desc = descs[i];
+            barriers.emplace_back(
                 desc.src_access,
                 desc.dst_access,
                 desc.old_image_layout,
@@ -299,14 +416,13 @@ namespace DnmGLLite::Vulkan {
                 VK_QUEUE_FAMILY_IGNORED,
                 VK_QUEUE_FAMILY_IGNORED,
                 desc.image,
-                vk::ImageSubresourceRange( // sub resource
-                        desc.image_aspect, // aspect
-                        0, // base mipmap
-                        VK_REMAINING_MIP_LEVELS, // mipmap count
-                        0, // base layer
-                        VK_REMAINING_ARRAY_LAYERS // layer count
-                    ))
-            };
+                vk::ImageSubresourceRange(desc.range).setAspectMask(desc.image_aspect)
+            );
+
+            const bool run_end = i + 1 == descs.size()
+                || descs[i + 1].src_pipeline_stages != desc.src_pipeline_stages
+                || descs[i + 1].dst_pipeline_stages != desc.dst_pipeline_stages;
+            if (!run_end) continue;
 
             command_buffer.pipelineBarrier(
                 desc.src_pipeline_stages,
@@ -314,7 +430,8 @@ namespace DnmGLLite::Vulkan {
                 {}, 
                 {}, 
                 {}, 
-                barrier);
+                barriers);
+            barriers.clear();
         }
     }
     
@@ -334,13 +451,7 @@ namespace DnmGLLite::Vulkan {
                 VK_QUEUE_FAMILY_IGNORED,
                 VK_QUEUE_FAMILY_IGNORED,
                 desc.image,
-                vk::ImageSubresourceRange( // sub resource
-                        desc.image_aspect, // aspect
-                        0, // base mipmap
-                        VK_REMAINING_MIP_LEVELS, // mipmap count
-                        0, // base layer
-                        VK_REMAINING_ARRAY_LAYERS // layer count
-                    )
+                vk::ImageSubresourceRange(desc.range).setAspectMask(desc.image_aspect)
             );
         }
 
@@ -358,163 +469,454 @@ namespace DnmGLLite::Vulkan {
             dependency_descs, VulkanContext->GetDispatcher());
     }
 
-    void CommandBuffer::GenerateMipmaps(DnmGLLite::Image* image) {
-        auto& image_desc = image->GetDesc();
+    void CommandBuffer::Barrier(std::span<const ResourceBarrierDesc> barriers, std::span<const BarrierResource> resources) {
+        DnmGLLiteAssert(!m_secondary, "barriers can't be recorded in secondaries, they continue a render pass")
+        for (const auto& resource : resources) {
+            auto& state = resource.image 
+                ? static_cast<Vulkan::Image*>(resource.image)->m_state 
+                : static_cast<const Vulkan::Buffer*>(resource.buffer)->m_state;
+            const auto scope = GetVkUsageScope(resource.usage);
+            state.synchronized_stages = scope.stages;
+            state.synchronized_access = scope.access;
+        }
+        if (barriers.empty()) return;
+
+        vk::MemoryBarrier barrier{};
+        vk::PipelineStageFlags src_pipeline_flags{};
+        vk::PipelineStageFlags dst_pipeline_flags{};
+
+        for (const auto& desc : barriers) {
+            const auto src_scope = GetVkUsageScope(desc.src_usage);
+            const auto dst_scope = GetVkUsageScope(desc.dst_usage);
+
+            src_pipeline_flags |= src_scope.stages;
+            dst_pipeline_flags |= dst_scope.stages;
+            // read after read needs execution dependency only
+            if (IsWriteUsage(desc.src_usage)) {
+                barrier.srcAccessMask |= src_scope.access;
+                barrier.dstAccessMask |= dst_scope.access;
+            }
+        }
+
+        if (m_compute_only) {
+            src_pipeline_flags &= compute_queue_stages;
+            dst_pipeline_flags &= compute_queue_stages;
+            barrier.srcAccessMask &= compute_queue_access;
+            barrier.dstAccessMask &= compute_queue_access;
+            if (!src_pipeline_flags) src_pipeline_flags = vk::PipelineStageFlagBits::eTopOfPipe;
+            if (!dst_pipeline_flags) dst_pipeline_flags = vk::PipelineStageFlagBits::eBottomOfPipe;
+        }
+
+        command_buffer.pipelineBarrier(
+            src_pipeline_flags,
+            dst_pipeline_flags,
+            {},
+            barrier,
+            {},
+            {});
+    }
+
+    void CommandBuffer::DiscardContent(DnmGLLite::Image* image) {
         auto* typed_image = static_cast<Vulkan::Image*>(image);
+        // accesses of the other images in the memory are waited by the caller's barriers, see RenderGraph::DeriveBarriers
+        typed_image->SetImageLayout(vk::ImageLayout::eUndefined);
+        typed_image->m_state = {};
+    }
+
+    void CommandBuffer::ResourceBarrier(std::span<const ResourceAccess> accesses) {
+        // copies, compute binds, indirect dispatches and mipmap generation come here too
+        DnmGLLiteAssert(!m_secondary, "barriers can't be recorded in secondaries, they continue a render pass")
+        std::vector<vk::BufferMemoryBarrier> buffer_barriers{};
+        std::vector<vk::ImageMemoryBarrier> image_barriers{};
+        // stages of each barrier, the sync2 path doesn't merge them
+        std::vector<BarrierStages> buffer_barrier_stages{};
+        std::vector<BarrierStages> image_barrier_stages{};
+
+        for (const auto& access : accesses) {
+            auto& state = access.buffer ? access.buffer->m_state : access.image->m_state;
+            const bool transition = access.image && access.layout != vk::ImageLayout::eUndefined 
+                && !access.image->HasImageLayout(access.range, access.layout);
+            const bool write_access = IsWriteAccess(access.access);
+            // earlier uses waited by a Barrier for these, cleared by writes and transitions
+            const auto synchronized_stages = state.synchronized_stages;
+            const bool synchronized = (synchronized_stages & access.stages) == access.stages
+                && (state.synchronized_access & access.access) == access.access;
+
+            vk::PipelineStageFlags src_stages{};
+            vk::AccessFlags src_access{};
+            if (write_access || transition) {
+                // write after read needs execution dependency only
+                src_stages = state.write_stages | state.read_stages;
+                src_access = state.write_access;
+
+                state = {
+                    .write_stages = access.stages,
+                    .write_access = write_access ? access.access : vk::AccessFlags{},
+                    .read_stages = write_access ? vk::PipelineStageFlags{} : access.stages,
+                    .read_access = write_access ? vk::AccessFlags{} : access.access,
+                };
+            }
+            else {
+                // last write already visible to these reads
+                const bool visible = (state.read_stages & access.stages) == access.stages 
+                    && (state.read_access & access.access) == access.access;
+                if (!visible) {
+                    src_stages = state.write_stages;
+                    src_access = state.write_access;
+                }
+                state.read_stages |= access.stages;
+                state.read_access |= access.access;
+            }
+
+            // transition continues the dependency chain of the Barrier
+            if (synchronized) {
+                src_stages = transition ? synchronized_stages : vk::PipelineStageFlags{};
+                src_access = {};
+            }
+
+            auto dst_stages = access.stages;
+            auto dst_access = access.access;
+            if (m_compute_only) {
+                src_stages &= compute_queue_stages;
+                src_access &= compute_queue_access;
+                dst_stages &= compute_queue_stages;
+                dst_access &= compute_queue_access;
+            }
 
-        const auto& barrier = [
-            cmd_buffer = command_buffer, 
-            vk_image = typed_image->GetImage(),
-            vk_aspect = typed_image->GetAspect()
-        ] (
-            vk::AccessFlags src_access,
-            vk::AccessFlags dst_access,
-            vk::PipelineStageFlags src_pipeline_stage,
-            vk::PipelineStageFlags dst_pipeline_stage,
-            vk::ImageLayout old_image_layout,
-            vk::ImageLayout new_image_layout,
-            uint32_t mipmap_level,
-            uint32_t array_layer
-        ) {
-            const vk::ImageMemoryBarrier image_barrier(
+            if (!src_stages && !transition) continue;
+
+            const BarrierStages stages{
+                .src = src_stages ? src_stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe),
+                .dst = dst_stages ? dst_stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe),
+            };
+
+            if (access.buffer) {
+                buffer_barriers.emplace_back(
+                    src_access,
+                    dst_access,
+                    VK_QUEUE_FAMILY_IGNORED,
+                    VK_QUEUE_FAMILY_IGNORED,
+                    access.buffer->GetBuffer(),
+                    0,
+                    VK_WHOLE_SIZE);
+                buffer_barrier_stages.emplace_back(stages);
+                continue;
+            }
+
+            access.image->AddLayoutBarriers(
+                image_barriers,
+                access.range,
+                transition ? access.layout : vk::ImageLayout::eUndefined,
                 src_access,
-                dst_access,
-                old_image_layout,
-                new_image_layout,
-                VK_QUEUE_FAMILY_IGNORED,
-                VK_QUEUE_FAMILY_IGNORED,
-                vk_image,
-                vk::ImageSubresourceRange( // sub resource
-                        vk_aspect, // aspect
-                        mipmap_level, // base mipmap
-                        1, // mipmap count
-                        array_layer, // base layer
-                        1 // layer count
-                    )
-            );
+                dst_access);
+            image_barrier_stages.resize(image_barriers.size(), stages);
+        }
 
-            cmd_buffer.pipelineBarrier(
-                src_pipeline_stage,
-                dst_pipeline_stage,
-                {},
-                {},
-                {},
-                {image_barrier}
-            );
-        };
+        if (buffer_barriers.empty() && image_barriers.empty()) return;
 
-        TransferImageLayoutDesc layout_transfer_barrier{
-            typed_image,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::PipelineStageFlagBits::eBottomOfPipe,
-            vk::PipelineStageFlagBits::eTransfer,
+        if (VulkanContext->GetSupportedFeatures().sync2) {
+            ResourceBarrierSync2(buffer_barriers, buffer_barrier_stages, image_barriers, image_barrier_stages);
+            return;
+        }
+
+        vk::PipelineStageFlags src_pipeline_flags{};
+        vk::PipelineStageFlags dst_pipeline_flags{};
+        for (const auto& stages : buffer_barrier_stages) {
+            src_pipeline_flags |= stages.src;
+            dst_pipeline_flags |= stages.dst;
+        }
+        for (const auto& stages : image_barrier_stages) {
+            src_pipeline_flags |= stages.src;
+            dst_pipeline_flags |= stages.dst;
+        }
+
+        command_buffer.pipelineBarrier(
+            src_pipeline_flags,
+            dst_pipeline_flags,
             {},
-            vk::AccessFlagBits::eTransferWrite,
-        };
+            {},
+            buffer_barriers,
+            image_barriers);
+    }
 
-        //transfer whole image layout
-        TransferImageLayout(std::span(&layout_transfer_barrier, 1));
-
-        for (uint32_t array_index = 0; array_index < image_desc.extent.z; ++array_index) {
-            int32_t mipWidth = image_desc.extent.x;
-            int32_t mipHeight = image_desc.extent.y;
-
-            for (uint32_t mipmap_index = 1; mipmap_index < image_desc.mipmap_levels; ++mipmap_index) {
-                barrier(
-                    vk::AccessFlagBits::eTransferWrite,
-                    vk::AccessFlagBits::eTransferRead,
-                    vk::PipelineStageFlagBits::eTransfer,
-                    vk::PipelineStageFlagBits::eTransfer,
-                    vk::ImageLayout::eTransferDstOptimal,
-                    vk::ImageLayout::eTransferSrcOptimal,
-                    mipmap_index - 1,
-                    array_index
-                );
+    void CommandBuffer::ResourceBarrierSync2(
+        std::span<const vk::BufferMemoryBarrier> buffer_barriers, std::span<const BarrierStages> buffer_barrier_stages,
+        std::span<const vk::ImageMemoryBarrier> image_barriers, std::span<const BarrierStages> image_barrier_stages) const {
+        std::vector<vk::BufferMemoryBarrier2> buffer_barriers2{};
+        buffer_barriers2.reserve(buffer_barriers.size());
+        for (uint32_t i{}; i < buffer_barriers.size(); ++i) {
+            const auto& barrier = buffer_barriers[i];
+            buffer_barriers2.emplace_back(
+                static_cast<vk::PipelineStageFlags2>((uint32_t)buffer_barrier_stages[i].src),
+                static_cast<vk::AccessFlags2>((uint32_t)barrier.srcAccessMask),
+                static_cast<vk::PipelineStageFlags2>((uint32_t)buffer_barrier_stages[i].dst),
+                static_cast<vk::AccessFlags2>((uint32_t)barrier.dstAccessMask),
+                barrier.srcQueueFamilyIndex,
+                barrier.dstQueueFamilyIndex,
+                barrier.buffer,
+                barrier.offset,
+                barrier.size);
+        }
 
-                vk::ImageBlit image_blit(
-                    vk::ImageSubresourceLayers(
-                        typed_image->GetAspect(),
-                        mipmap_index - 1,
-                        array_index,
-                        1
-                    ),
-                    {vk::Offset3D{}, {mipWidth, mipHeight, 1}},
-                    vk::ImageSubresourceLayers(
-                        typed_image->GetAspect(),
-                        mipmap_index,
-                        array_index,
-                        1
-                    ),
-                    {vk::Offset3D{}, {
-                        mipWidth > 1 ? mipWidth / 2 : 1,
-                        mipHeight > 1 ? mipHeight / 2 : 1,
-                        1}}
-                );
+        std::vector<vk::ImageMemoryBarrier2> image_barriers2{};
+        image_barriers2.reserve(image_barriers.size());
+        for (uint32_t i{}; i < image_barriers.size(); ++i) {
+            const auto& barrier = image_barriers[i];
+            image_barriers2.emplace_back(
+                static_cast<vk::PipelineStageFlags2>((uint32_t)image_barrier_stages[i].src),
+                static_cast<vk::AccessFlags2>((uint32_t)barrier.srcAccessMask),
+                static_cast<vk::PipelineStageFlags2>((uint32_t)image_barrier_stages[i].dst),
+                static_cast<vk::AccessFlags2>((uint32_t)barrier.dstAccessMask),
+                barrier.oldLayout,
+                barrier.newLayout,
+                barrier.srcQueueFamilyIndex,
+                barrier.dstQueueFamilyIndex,
+                barrier.image,
+                barrier.subresourceRange);
+        }
 
-                command_buffer.blitImage(
-                    typed_image->GetImage(),
-                    vk::ImageLayout::eTransferSrcOptimal,
-                    typed_image->GetImage(),
-                    vk::ImageLayout::eTransferDstOptimal,
-                    {image_blit},
-                    vk::Filter::eLinear
-                );
+        command_buffer.pipelineBarrier2KHR(
+            vk::DependencyInfo{}
+                .setBufferMemoryBarriers(buffer_barriers2)
+                .setImageMemoryBarriers(image_barriers2),
+            VulkanContext->GetDispatcher());
+    }
 
-                if (mipWidth > 1) mipWidth /= 2;
-                if (mipHeight > 1) mipHeight /= 2;
-            }
+    void CommandBuffer::AddResourceAccesses(
+        std::vector<ResourceAccess>& accesses, const DnmGLLite::ResourceManager* resource_manager, vk::PipelineStageFlags stages) {
+        const auto* typed_resource_manager = static_cast<const Vulkan::ResourceManager*>(resource_manager);
 
-            barrier(
-                vk::AccessFlagBits::eTransferWrite,
-                {},
-                vk::PipelineStageFlagBits::eTransfer,
-                vk::PipelineStageFlagBits::eTopOfPipe,
-                vk::ImageLayout::eTransferDstOptimal,
-                vk::ImageLayout::eTransferSrcOptimal,
-                image_desc.mipmap_levels - 1,
-                array_index
-            );
+        for (const auto& resource : typed_resource_manager->GetTrackedResources() | std::views::values) {
+            const auto used_stages = resource.stages & stages;
+            if (!used_stages) continue;
+            accesses.emplace_back(resource.buffer, resource.image, used_stages, resource.access);
+        }
+    }
+
+    void CommandBuffer::CheckPassIndirectBuffer(const DnmGLLite::Buffer* buffer) const {
+        DnmGLLiteAssert(std::ranges::contains(m_pass_indirect_buffers, buffer), 
+            "indirect buffer isn't in indirect_buffers of BeginRendering, its earlier writes aren't waited")
+    }
+
+    void CommandBuffer::DrawIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) {
+        if (m_bound_state.bind_points[0].pipeline_pending) return;
+        CheckPassIndirectBuffer(buffer);
+
+        command_buffer.drawIndirect(
+            static_cast<const Vulkan::Buffer*>(buffer)->GetBuffer(), 
+            offset, 
+            draw_count, 
+            stride ? stride : sizeof(DrawIndirectCommand));
+    }
+
+    void CommandBuffer::DrawIndexedIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) {
+        if (m_bound_state.bind_points[0].pipeline_pending) return;
+        CheckPassIndirectBuffer(buffer);
+
+        command_buffer.drawIndexedIndirect(
+            static_cast<const Vulkan::Buffer*>(buffer)->GetBuffer(), 
+            offset, 
+            draw_count, 
+            stride ? stride : sizeof(DrawIndexedIndirectCommand));
+    }
+
+    void CommandBuffer::DrawIndirectCount(const DnmGLLite::Buffer* buffer, uint64_t offset, 
+        const DnmGLLite::Buffer* count_buffer, uint64_t count_offset, uint32_t max_draw_count, uint32_t stride) {
+        if (m_bound_state.bind_points[0].pipeline_pending) return;
+        if (!VulkanContext->GetSupportedFeatures().draw_indirect_count) {
+            VulkanContext->Message("draw indirect count not supported by device", MessageType::eUnsupportedDevice);
+            return;
+        }
+
+        CheckPassIndirectBuffer(buffer);
+        CheckPassIndirectBuffer(count_buffer);
+
+        command_buffer.drawIndirectCountKHR(
+            static_cast<const Vulkan::Buffer*>(buffer)->GetBuffer(), 
+            offset, 
+            static_cast<const Vulkan::Buffer*>(count_buffer)->GetBuffer(), 
+            count_offset, 
+            max_draw_count, 
+            stride ? stride : sizeof(DrawIndirectCommand),
+            VulkanContext->GetDispatcher());
+    }
+
+    void CommandBuffer::DrawIndexedIndirectCount(const DnmGLLite::Buffer* buffer, uint64_t offset, 
+        const DnmGLLite::Buffer* count_buffer, uint64_t count_offset, uint32_t max_draw_count, uint32_t stride) {
+        if (m_bound_state.bind_points[0].pipeline_pending) return;
+        if (!VulkanContext->GetSupportedFeatures().draw_indirect_count) {
+            VulkanContext->Message("draw indirect count not supported by device", MessageType::eUnsupportedDevice);
+            return;
         }
 
-        //old image layout
-        typed_image->m_image_layout = vk::ImageLayout::eTransferSrcOptimal;
+        CheckPassIndirectBuffer(buffer);
+        CheckPassIndirectBuffer(count_buffer);
 
-        layout_transfer_barrier = {
-            typed_image,
-            typed_image->GetIdealImageLayout(),
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eVertexShader,
-            vk::AccessFlagBits::eTransferRead,
-            {}
+        command_buffer.drawIndexedIndirectCountKHR(
+            static_cast<const Vulkan::Buffer*>(buffer)->GetBuffer(), 
+            offset, 
+            static_cast<const Vulkan::Buffer*>(count_buffer)->GetBuffer(), 
+            count_offset, 
+            max_draw_count, 
+            stride ? stride : sizeof(DrawIndexedIndirectCommand),
+            VulkanContext->GetDispatcher());
+    }
+
+    void CommandBuffer::DispatchIndirect(const DnmGLLite::Buffer* buffer, uint64_t offset) {
+        if (m_bound_state.bind_points[1].pipeline_pending) return;
+        const auto* typed_buffer = static_cast<const Vulkan::Buffer*>(buffer);
+        const ResourceAccess access{
+            .buffer = typed_buffer,
+            .image = nullptr,
+            .stages = vk::PipelineStageFlagBits::eDrawIndirect,
+            .access = vk::AccessFlagBits::eIndirectCommandRead,
         };
+        ResourceBarrier({&access, 1});
 
-        //transfer whole images, layout
-        TransferImageLayout(std::span(&layout_transfer_barrier, 1));
+        command_buffer.dispatchIndirect(typed_buffer->GetBuffer(), offset);
+    }
+
+    void CommandBuffer::GenerateMipmaps(DnmGLLite::Image* image) {
+        auto& image_desc = image->GetDesc();
+        auto* typed_image = static_cast<Vulkan::Image*>(image);
+        const uint32_t layer_count = typed_image->GetLayerCount();
+
+        //transfer whole image layout
+        {
+            const ResourceAccess access{
+                .buffer = nullptr,
+                .image = typed_image,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferWrite,
+                .layout = vk::ImageLayout::eTransferDstOptimal,
+            };
+            ResourceBarrier({&access, 1});
+        }
+
+        int32_t mipWidth = image_desc.extent.x;
+        int32_t mipHeight = image_desc.extent.y;
+
+        // every layer of a level blitted at once, only the source level is transitioned
+        for (uint32_t mipmap_index = 1; mipmap_index < image_desc.mipmap_levels; ++mipmap_index) {
+            const ResourceAccess access{
+                .buffer = nullptr,
+                .image = typed_image,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferRead,
+                .layout = vk::ImageLayout::eTransferSrcOptimal,
+                .range = {{}, mipmap_index - 1, 1, 0, layer_count},
+            };
+            ResourceBarrier({&access, 1});
+
+            vk::ImageBlit image_blit(
+                vk::ImageSubresourceLayers(
+                    typed_image->GetAspect(),
+                    mipmap_index - 1,
+                    0,
+                    layer_count
+                ),
+                {vk::Offset3D{}, {mipWidth, mipHeight, 1}},
+                vk::ImageSubresourceLayers(
+                    typed_image->GetAspect(),
+                    mipmap_index,
+                    0,
+                    layer_count
+                ),
+                {vk::Offset3D{}, {
+                    mipWidth > 1 ? mipWidth / 2 : 1,
+                    mipHeight > 1 ? mipHeight / 2 : 1,
+                    1}}
+            );
+
+            command_buffer.blitImage(
+                typed_image->GetImage(),
+                vk::ImageLayout::eTransferSrcOptimal,
+                typed_image->GetImage(),
+                vk::ImageLayout::eTransferDstOptimal,
+                {image_blit},
+                vk::Filter::eLinear
+            );
+            // the next level's transition waits this write
+            typed_image->m_state = {.write_stages = vk::PipelineStageFlagBits::eTransfer, .write_access = vk::AccessFlagBits::eTransferWrite};
+
+            if (mipWidth > 1) mipWidth /= 2;
+            if (mipHeight > 1) mipHeight /= 2;
+        }
+
+        //transfer whole images, layout. last level is still transfer dst
+        {
+            const ResourceAccess access{
+                .buffer = nullptr,
+                .image = typed_image,
+                .stages = vk::PipelineStageFlagBits::eVertexShader,
+                .access = vk::AccessFlagBits::eShaderRead,
+                .layout = typed_image->GetIdealImageLayout(),
+            };
+            ResourceBarrier({&access, 1});
+        }
     }
 
     void CommandBuffer::BindVertexBuffer(const DnmGLLite::Buffer *buffer, uint64_t offset) {
+        const auto vk_buffer = static_cast<const Vulkan::Buffer *>(buffer)->GetBuffer();
+        if (m_bound_state.vertex_buffer == vk_buffer && m_bound_state.vertex_buffer_offset == offset) return;
+
         command_buffer.bindVertexBuffers(
             0, 
-            {static_cast<const Vulkan::Buffer *>(buffer)->GetBuffer()}, 
+            {vk_buffer}, 
             {offset});
+        m_bound_state.vertex_buffer = vk_buffer;
+        m_bound_state.vertex_buffer_offset = offset;
     }
 
     void CommandBuffer::BindIndexBuffer(const DnmGLLite::Buffer *buffer, uint64_t offset, DnmGLLite::IndexType index_type) {
+        const auto vk_buffer = static_cast<const Vulkan::Buffer *>(buffer)->GetBuffer();
+        const auto vk_index_type = static_cast<vk::IndexType>(index_type);
+        if (m_bound_state.index_buffer == vk_buffer 
+            && m_bound_state.index_buffer_offset == offset 
+            && m_bound_state.index_type == vk_index_type) return;
+
         command_buffer.bindIndexBuffer(
-            static_cast<const Vulkan::Buffer *>(buffer)->GetBuffer(), 
+            vk_buffer, 
             offset, 
-            static_cast<vk::IndexType>(index_type));
+            vk_index_type);
+        m_bound_state.index_buffer = vk_buffer;
+        m_bound_state.index_buffer_offset = offset;
+        m_bound_state.index_type = vk_index_type;
     }
 
     void CommandBuffer::UploadData(const DnmGLLite::Buffer *buffer, const void* data, uint32_t size, uint32_t offset) {
+        DnmGLLiteAssert(!m_secondary, "uploads can't be recorded in secondaries, they continue a render pass")
         const auto *typed_buffer = static_cast<const Vulkan::Buffer *>(buffer);
 
         if (size < 65536) {
+            const ResourceAccess access{
+                .buffer = typed_buffer,
+                .image = nullptr,
+                .stages = vk::PipelineStageFlagBits::eTransfer,
+                .access = vk::AccessFlagBits::eTransferWrite,
+            };
+            ResourceBarrier({&access, 1});
+
             command_buffer.updateBuffer(typed_buffer->GetBuffer(), offset, size, data);
             return;
         }
 
-        //No problem, the Vulkan object is destroyed at the start of ExecuteCommands() or Render()
+        // buffer copies have no offset rules, 4 keeps the memcpy destination aligned
+        if (const auto staging = m_frame_staging ? VulkanContext->AllocateStaging(size, 4) : std::nullopt) {
+            memcpy(staging->mapped_ptr, data, size);
+
+            CopyBufferToBuffer({
+                .src_buffer = staging->buffer,
+                .dst_buffer = typed_buffer,
+                .src_offset = staging->offset,
+                .dst_offset = offset,
+                .copy_size = size,
+            });
+            return;
+        }
+
+        //too big for the staging ring
+        //No problem, the Vulkan object is destroyed after this frame's fence signaled
         const Vulkan::Buffer staging_buffer(*VulkanContext, {
             .size = size,
             .memory_host_access = MemoryHostAccess::eWrite,
@@ -522,19 +924,38 @@ namespace DnmGLLite::Vulkan {
             .buffer_flags = {},
         });
 
-        memcpy(staging_buffer.GetMappedPtr() + offset, data, size);
+        memcpy(staging_buffer.GetMappedPtr(), data, size);
 
         CopyBufferToBuffer({
             .src_buffer = &staging_buffer,
             .dst_buffer = typed_buffer,
-            .src_offset = offset,
-            .dst_offset = 0,
+            .src_offset = 0,
+            .dst_offset = offset,
             .copy_size = size,
         });
     }
 
     void CommandBuffer::UploadData(DnmGLLite::Image *image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset) {
-        //No problem, the Vulkan object is destroyed at the start of ExecuteCommands() or Render()
+        DnmGLLiteAssert(!m_secondary, "uploads can't be recorded in secondaries, they continue a render pass")
+        const auto alignment = static_cast<const Vulkan::Image*>(image)->GetCopyAlignment();
+        if (const auto staging = m_frame_staging ? VulkanContext->AllocateStaging(size, alignment) : std::nullopt) {
+            memcpy(staging->mapped_ptr, data, size);
+
+            CopyBufferToImage({
+                .src_buffer = staging->buffer,
+                .dst_image = image,
+                .image_subresource = subresource,
+                .buffer_offset = staging->offset,
+                .buffer_row_lenght = image->GetDesc().extent.x,
+                .buffer_image_height = image->GetDesc().extent.y,
+                .image_offset = {offset.x, offset.y, offset.z},
+                .image_extent = image->GetDesc().extent,
+            });
+            return;
+        }
+
+        //too big for the staging ring
+        //No problem, the Vulkan object is destroyed after this frame's fence signaled
         const Vulkan::Buffer staging_buffer(*VulkanContext, {
             .size = size,
             .memory_host_access = MemoryHostAccess::eWrite,
@@ -559,28 +980,94 @@ namespace DnmGLLite::Vulkan {
     void CommandBuffer::BeginRendering(
             const DnmGLLite::GraphicsPipeline *pipeline, 
             std::span<const ColorFloat> color_clear_values, 
-            std::optional<DepthStencilClearValue> depth_stencil_clear_value) {
+            std::optional<DepthStencilClearValue> depth_stencil_clear_value,
+            bool secondary_contents,
+            std::span<const DnmGLLite::GraphicsPipeline* const> pass_pipelines,
+            std::span<const DnmGLLite::Buffer* const> indirect_buffers) {
+        DnmGLLiteAssert(!m_secondary, "secondaries can't begin or end rendering, they continue the primary's render pass")
         const auto* typed_pipeline = static_cast<const Vulkan::GraphicsPipeline *>(pipeline);
-        const auto renderpass = typed_pipeline->GetRenderpass();
-        const auto framebuffer = typed_pipeline->GetFramebuffer();
+        const bool dynamic_rendering = VulkanContext->GetSupportedFeatures().dynamic_rendering;
 
-        ResourceBarrier(
-            typed_pipeline->GetBufferResourceAccessInfo(), 
-            typed_pipeline->GetImageResourceAccessInfo());
+        DnmGLLiteAssert(m_render_pipeline == nullptr, "BeginRendering called in a render pass")
+        for (const auto* pass_pipeline : pass_pipelines) {
+            DnmGLLiteAssert(static_cast<const Vulkan::GraphicsPipeline *>(pass_pipeline)->IsRenderCompatible(*typed_pipeline), 
+                "pass pipelines must have the attachment formats and sample count of the render pass pipeline")
+        }
 
         ProcressDeferTranslateImageLayout();
 
-        command_buffer.bindDescriptorSets(
-                        vk::PipelineBindPoint::eGraphics, 
-                        typed_pipeline->GetPipelineLayout(),
-                        0,
-                        typed_pipeline->GetDstSets(),
-                        {});
+        // attachments wait their earlier uses, the render pass transitions them from undefined.
+        // dynamic rendering transitions them here, internal attachments are tracked too since no render pass dependency covers them
+        {
+            const auto color_layout = dynamic_rendering ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::eUndefined;
+            const auto depth_stencil_layout = dynamic_rendering ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eUndefined;
+
+            std::vector<ResourceAccess> accesses{};
+            AddResourceAccesses(accesses, typed_pipeline->GetDesc().resource_manager, 
+                vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader);
+            // no barriers inside the pass, resources of every pipeline bound in it are synchronized here
+            for (const auto* pass_pipeline : pass_pipelines) {
+                if (pass_pipeline->GetDesc().resource_manager == typed_pipeline->GetDesc().resource_manager) continue;
+                AddResourceAccesses(accesses, pass_pipeline->GetDesc().resource_manager, 
+                    vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader);
+            }
+            for (const auto* buffer : indirect_buffers) {
+                accesses.emplace_back(
+                    static_cast<const Vulkan::Buffer*>(buffer), 
+                    nullptr, 
+                    vk::PipelineStageFlagBits::eDrawIndirect, 
+                    vk::AccessFlagBits::eIndirectCommandRead);
+            }
 
-        command_buffer.bindPipeline(
-            vk::PipelineBindPoint::eGraphics, 
-            static_cast<const Vulkan::GraphicsPipeline*>(pipeline)->GetPipeline()
-        );
+            const auto add_color = [&] (Vulkan::Image* image) {
+                accesses.emplace_back(
+                    nullptr, 
+                    image, 
+                    vk::PipelineStageFlagBits::eColorAttachmentOutput, 
+                    vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+                    color_layout);
+            };
+            const auto add_depth_stencil = [&] (Vulkan::Image* image) {
+                accesses.emplace_back(
+                    nullptr, 
+                    image, 
+                    vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, 
+                    vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                    depth_stencil_layout);
+            };
+
+            for (auto* image : typed_pipeline->GetUserColorAttachments()) {
+                add_color(image);
+            }
+            // read back by copies after earlier renders
+            if (typed_pipeline->GetDesc().presenting && VulkanContext->IsHeadless()) {
+                add_color(VulkanContext->GetOffscreenImage());
+            }
+            if (auto* image = typed_pipeline->GetUserDepthStencilAttachment()) {
+                add_depth_stencil(image);
+            }
+            if (dynamic_rendering) {
+                for (const auto& image : typed_pipeline->GetInternalAttachments()) {
+                    if (image->GetDesc().usage_flags.Has(ImageUsageBits::eDepthStencilAttachment)) {
+                        add_depth_stencil(image.get());
+                    }
+                    else {
+                        add_color(image.get());
+                    }
+                }
+            }
+            ResourceBarrier(accesses);
+        }
+
+        m_render_pipeline = typed_pipeline;
+        m_pass_pipelines.assign(pass_pipelines.begin(), pass_pipelines.end());
+        m_pass_indirect_buffers.assign(indirect_buffers.begin(), indirect_buffers.end());
+        BindPipeline(pipeline);
+
+        if (dynamic_rendering) {
+            BeginDynamicRendering(typed_pipeline, color_clear_values, depth_stencil_clear_value, secondary_contents);
+            return;
+        }
 
         std::vector<vk::ClearValue> clear_values{};
         clear_values.reserve(color_clear_values.size() + 1);
@@ -596,52 +1083,273 @@ namespace DnmGLLite::Vulkan {
         }
 
         vk::RenderPassBeginInfo begin_desc{};
-        begin_desc.setRenderPass(renderpass)
-                    .setFramebuffer(framebuffer)
+        begin_desc.setRenderPass(typed_pipeline->GetRenderpass())
+                    .setFramebuffer(typed_pipeline->GetFramebuffer())
                     .setClearValues(clear_values)
                     .setRenderArea({{}, typed_pipeline->GetRenderArea()})
                     ;
 
         command_buffer.beginRenderPass(
             begin_desc, 
-            vk::SubpassContents::eInline);
+            secondary_contents ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+    }
+
+    void CommandBuffer::BindPipeline(const DnmGLLite::GraphicsPipeline* pipeline) {
+        const auto* typed_pipeline = static_cast<const Vulkan::GraphicsPipeline *>(pipeline);
+
+        DnmGLLiteAssert(m_render_pipeline != nullptr, "graphics pipelines are bound between BeginRendering and EndRendering")
+        DnmGLLiteAssert(typed_pipeline == m_render_pipeline || std::ranges::contains(m_pass_pipelines, pipeline), 
+            "pipeline isn't in pass_pipelines of BeginRendering, its resources aren't synchronized")
+
+        auto& bound = m_bound_state.bind_points[static_cast<uint32_t>(vk::PipelineBindPoint::eGraphics)];
+        bound.pipeline_pending = !typed_pipeline->IsReady();
+        if (bound.pipeline_pending) return;
+
+        BindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics, 
+            typed_pipeline->GetPipelineLayout(),
+            typed_pipeline->GetSetLayouts(),
+            typed_pipeline->GetPushConstantRanges(),
+            typed_pipeline->GetDstSets());
+        BindVkPipeline(vk::PipelineBindPoint::eGraphics, typed_pipeline->GetPipeline());
+    }
+
+    void CommandBuffer::BeginDynamicRendering(
+            const Vulkan::GraphicsPipeline *pipeline, 
+            std::span<const ColorFloat> color_clear_values, 
+            std::optional<DepthStencilClearValue> depth_stencil_clear_value,
+            bool secondary_contents) {
+        const auto& desc = pipeline->GetDesc();
+        const auto views = pipeline->GetAttachmentViews();
+        const uint32_t color_count = pipeline->GetColorAttachmentCount();
+
+        // swapchain images aren't tracked, content discarded like the render pass' undefined initial layout.
+        // acquire semaphore is waited at color attachment output. offscreen images transitioned in BeginRendering
+        if (desc.presenting && !VulkanContext->IsHeadless()) {
+            const vk::ImageMemoryBarrier barrier(
+                vk::AccessFlagBits::eColorAttachmentWrite,
+                vk::AccessFlagBits::eColorAttachmentWrite,
+                vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eColorAttachmentOptimal,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                VulkanContext->GetSwapchainImages()[VulkanContext->GetImageIndex()],
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+            command_buffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                {},
+                {},
+                {},
+                barrier);
+        }
+
+        std::vector<vk::RenderingAttachmentInfoKHR> color_attachments(color_count);
+        for (const auto i : Counter(color_count)) {
+            auto& attachment = color_attachments[i];
+            attachment.setImageView(views[i])
+                        .setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                        .setLoadOp(ToVk(desc.color_load_op[i]))
+                        .setStoreOp(ToVk(desc.color_store_op[i]));
+
+            if (i < color_clear_values.size()) {
+                const auto value = color_clear_values[i];
+                attachment.setClearValue(vk::ClearColorValue(std::array{value.r, value.g, value.b, value.a}));
+            }
+
+            // rendered to the internal msaa image and resolved to the user's
+            if (pipeline->HasMsaa()) {
+                attachment.setImageView(views[color_count + i])
+                            .setStoreOp(vk::AttachmentStoreOp::eDontCare)
+                            .setResolveMode(vk::ResolveModeFlagBits::eAverage)
+                            .setResolveImageView(views[i])
+                            .setResolveImageLayout(vk::ImageLayout::eColorAttachmentOptimal);
+            }
+        }
+
+        // depth and stencil share the view, load and store ops differ
+        const uint32_t depth_stencil_index = color_count * (pipeline->HasMsaa() + 1);
+        const bool has_depth_stencil_view = depth_stencil_index < views.size();
+
+        vk::RenderingAttachmentInfoKHR depth_attachment{};
+        vk::RenderingAttachmentInfoKHR stencil_attachment{};
+        if (has_depth_stencil_view) {
+            const auto clear_value = depth_stencil_clear_value.has_value() 
+                ? vk::ClearDepthStencilValue(depth_stencil_clear_value->depth, depth_stencil_clear_value->stencil)
+                : vk::ClearDepthStencilValue{};
+
+            depth_attachment.setImageView(views[depth_stencil_index])
+                            .setImageLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+                            .setLoadOp(ToVk(desc.depth_load_op))
+                            .setStoreOp(ToVk(desc.depth_store_op))
+                            .setClearValue(clear_value);
+            stencil_attachment.setImageView(views[depth_stencil_index])
+                            .setImageLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+                            .setLoadOp(ToVk(desc.stencil_load_op))
+                            .setStoreOp(ToVk(desc.stencil_store_op))
+                            .setClearValue(clear_value);
+        }
+
+        const auto rendering_info = vk::RenderingInfoKHR{}
+            .setFlags(secondary_contents ? vk::RenderingFlagBitsKHR::eContentsSecondaryCommandBuffers : vk::RenderingFlagsKHR{})
+            .setRenderArea({{}, pipeline->GetRenderArea()})
+            .setLayerCount(1)
+            .setColorAttachments(color_attachments)
+            .setPDepthAttachment(has_depth_stencil_view && pipeline->HasDepthAttachment() ? &depth_attachment : nullptr)
+            .setPStencilAttachment(has_depth_stencil_view && pipeline->HasStencilAttachment() ? &stencil_attachment : nullptr);
+
+        command_buffer.beginRenderingKHR(rendering_info, VulkanContext->GetDispatcher());
+    }
+
+    DnmGLLite::CommandBuffer* CommandBuffer::BeginSecondary(const DnmGLLite::GraphicsPipeline *pipeline, uint32_t index) {
+        DnmGLLiteAssert(!m_secondary, "secondaries can't begin secondaries")
+        DnmGLLiteAssert(index < m_secondaries.size(), 
+            "secondary index {} out of range, ContextDesc::secondary_command_buffer_count is {}", index, m_secondaries.size())
+
+        const auto* typed_pipeline = static_cast<const Vulkan::GraphicsPipeline *>(pipeline);
+        // render pass and framebuffer of the pass, pipeline may be one of its pass pipelines
+        const auto* render_pipeline = m_render_pipeline ? m_render_pipeline : typed_pipeline;
+        auto* secondary = m_secondaries[index];
+
+        const auto rendering_inheritance_info = vk::CommandBufferInheritanceRenderingInfoKHR{}
+            .setColorAttachmentFormats(typed_pipeline->GetColorFormats())
+            .setDepthAttachmentFormat(typed_pipeline->GetDepthFormat())
+            .setStencilAttachmentFormat(typed_pipeline->GetStencilFormat())
+            .setRasterizationSamples(static_cast<vk::SampleCountFlagBits>(typed_pipeline->GetDesc().msaa));
+
+        vk::CommandBufferInheritanceInfo inheritance_info{};
+        if (VulkanContext->GetSupportedFeatures().dynamic_rendering) {
+            inheritance_info.setPNext(&rendering_inheritance_info);
+        }
+        else {
+            inheritance_info.setRenderPass(render_pipeline->GetRenderpass())
+                            .setSubpass(0)
+                            .setFramebuffer(render_pipeline->GetFramebuffer());
+        }
+
+        // pool reset with the frame
+        // bound state not inherited from primary
+        secondary->BeginVk(vk::CommandBufferBeginInfo{}
+            .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+            .setPInheritanceInfo(&inheritance_info));
+
+        secondary->m_secondary_recorded = true;
+        // BindPipeline in the secondary takes the same pipelines
+        secondary->m_render_pipeline = render_pipeline;
+        secondary->m_pass_pipelines = m_pass_pipelines;
+        secondary->m_pass_indirect_buffers = m_pass_indirect_buffers;
+
+        secondary->BindPipeline(pipeline);
+        return secondary;
+    }
+
+    void CommandBuffer::ExecuteSecondaries() {
+        DnmGLLiteAssert(!m_secondary, "secondaries can't execute secondaries")
+        std::vector<vk::CommandBuffer> command_buffers{};
+        command_buffers.reserve(m_secondaries.size());
+
+        for (auto* secondary : m_secondaries) {
+            if (!secondary->m_secondary_recorded) continue;
+            command_buffers.emplace_back(secondary->command_buffer);
+            m_used_sets.insert(m_used_sets.end(), secondary->m_used_sets.begin(), secondary->m_used_sets.end());
+            secondary->m_secondary_recorded = false;
+            secondary->m_render_pipeline = nullptr;
+        }
+
+        if (!command_buffers.empty()) {
+            command_buffer.executeCommands(command_buffers);
+            // primary's state is undefined after vkCmdExecuteCommands
+            m_bound_state = {};
+        }
     }
 
     void CommandBuffer::EndRendering(const DnmGLLite::GraphicsPipeline *pipeline) {
-        command_buffer.endRenderPass();
+        DnmGLLiteAssert(!m_secondary, "secondaries can't begin or end rendering, they continue the primary's render pass")
+        const auto* typed_pipeline = static_cast<const Vulkan::GraphicsPipeline *>(pipeline);
+        const bool dynamic_rendering = VulkanContext->GetSupportedFeatures().dynamic_rendering;
+
+        DnmGLLiteAssert(typed_pipeline == m_render_pipeline, "EndRendering takes the pipeline given to BeginRendering")
+        m_render_pipeline = nullptr;
+        m_pass_pipelines.clear();
+        m_pass_indirect_buffers.clear();
+
+        if (dynamic_rendering) {
+            command_buffer.endRenderingKHR(VulkanContext->GetDispatcher());
+        }
+        else {
+            command_buffer.endRenderPass();
+        }
+
+        // final layout of presenting render passes
+        if (dynamic_rendering && typed_pipeline->GetDesc().presenting 
+            && VulkanContext->GetPresentImageLayout() != vk::ImageLayout::eColorAttachmentOptimal) {
+            const vk::ImageMemoryBarrier barrier(
+                vk::AccessFlagBits::eColorAttachmentWrite,
+                {},
+                vk::ImageLayout::eColorAttachmentOptimal,
+                VulkanContext->GetPresentImageLayout(),
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                VulkanContext->GetSwapchainImages()[VulkanContext->GetImageIndex()],
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
 
-        // translate user image's layouts
+            command_buffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                vk::PipelineStageFlagBits::eBottomOfPipe,
+                {},
+                {},
+                {},
+                barrier);
+        }
+
+        // render pass leaves attachments in attachment layouts, translated back to ideal layouts
         {
-            const auto* typed_pipeline = static_cast<const Vulkan::GraphicsPipeline *>(pipeline);
             auto& user_color_images = typed_pipeline->GetUserColorAttachments();
             auto* user_depth_stencil_image = typed_pipeline->GetUserDepthStencilAttachment();
-    
-            std::vector<TransferImageLayoutDesc> transfer_image_layout;
-            transfer_image_layout.reserve(user_color_images.size() + 2);
-    
-            for (auto& image : user_color_images) {
-                transfer_image_layout.emplace_back(
+
+            std::vector<ResourceAccess> accesses{};
+            accesses.reserve(user_color_images.size() + 1);
+
+            const auto add_attachment = [&accesses] (Vulkan::Image* image, vk::ImageLayout layout, 
+                vk::PipelineStageFlags stages, vk::AccessFlags access) {
+                image->SetImageLayout(layout);
+                image->m_state = {.write_stages = stages, .write_access = access};
+
+                if (image->GetIdealImageLayout() == layout) return;
+                accesses.emplace_back(
+                    nullptr,
                     image,
-                    GetIdealImageLayout(image->GetDesc().usage_flags),
-                    vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                    vk::PipelineStageFlagBits::eTopOfPipe,
-                    vk::AccessFlagBits::eColorAttachmentWrite,
-                    vk::AccessFlagBits{}
-                );
+                    vk::PipelineStageFlagBits::eVertexShader,
+                    vk::AccessFlagBits::eShaderRead,
+                    image->GetIdealImageLayout());
+            };
+
+            for (auto* image : user_color_images) {
+                add_attachment(
+                    image, 
+                    vk::ImageLayout::eColorAttachmentOptimal, 
+                    vk::PipelineStageFlagBits::eColorAttachmentOutput, 
+                    vk::AccessFlagBits::eColorAttachmentWrite);
             }
-            
             if (user_depth_stencil_image != nullptr) {
-                transfer_image_layout.emplace_back(
-                    user_depth_stencil_image,
-                    GetIdealImageLayout(user_depth_stencil_image->GetDesc().usage_flags),
-                    vk::PipelineStageFlagBits::eLateFragmentTests,
-                    vk::PipelineStageFlagBits::eTopOfPipe,
-                    vk::AccessFlagBits::eDepthStencilAttachmentWrite,
-                    vk::AccessFlagBits{}
-                );
+                add_attachment(
+                    user_depth_stencil_image, 
+                    vk::ImageLayout::eDepthStencilAttachmentOptimal, 
+                    vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, 
+                    vk::AccessFlagBits::eDepthStencilAttachmentWrite);
             }
-    
-            TransferImageLayout(transfer_image_layout);
+            // final layout of headless presenting passes, GetRenderTargetImage copies wait the writes.
+            // ideal layout of a color attachment, so no transition
+            if (typed_pipeline->GetDesc().presenting && VulkanContext->IsHeadless()) {
+                add_attachment(
+                    VulkanContext->GetOffscreenImage(), 
+                    vk::ImageLayout::eColorAttachmentOptimal, 
+                    vk::PipelineStageFlagBits::eColorAttachmentOutput, 
+                    vk::AccessFlagBits::eColorAttachmentWrite);
+            }
+
+            ResourceBarrier(accesses);
         }
     }
 
@@ -650,22 +1358,19 @@ namespace DnmGLLite::Vulkan {
             return;
         }
 
-        std::vector<TransferImageLayoutDesc> image_layout_transfer_desc;
-        image_layout_transfer_desc.reserve(m_defer_translate_image_layout.size());
+        std::vector<ResourceAccess> accesses;
+        accesses.reserve(m_defer_translate_image_layout.size());
 
         for (auto* image : m_defer_translate_image_layout) {
-            const auto dst_access_flag = 
-                image->GetIdealImageLayout() == vk::ImageLayout::eTransferSrcOptimal ? vk::AccessFlagBits::eTransferRead : vk::AccessFlagBits::eTransferWrite;
-            image_layout_transfer_desc.emplace_back(
+            accesses.emplace_back(
+                nullptr,
                 image,
-                image->GetIdealImageLayout(),
-                vk::PipelineStageFlagBits::eTransfer,
                 vk::PipelineStageFlagBits::eVertexShader,
-                dst_access_flag,
-                vk::AccessFlagBits::eShaderRead
+                vk::AccessFlagBits::eShaderRead,
+                image->GetIdealImageLayout()
             );
         }
-        TransferImageLayout(image_layout_transfer_desc);
+        ResourceBarrier(accesses);
         m_defer_translate_image_layout.clear();
     }
 }
\ No newline at end of file
@@ -8,6 +8,10 @@
 #include "DnmGLLite/Vulkan/ResourceManager.hpp"
 #include "DnmGLLite/Vulkan/Pipeline.hpp"
 #include "DnmGLLite/Vulkan/Sampler.hpp"
+#include "DnmGLLite/Vulkan/UploadEngine.hpp"
+#include "DnmGLLite/Vulkan/PipelineCache.hpp"
+#include "DnmGLLite/Vulkan/DescriptorAllocator.hpp"
+#include "DnmGLLite/Vulkan/BindlessTable.hpp"
 #include <format>
 #include <print>
 
@@ -25,12 +29,15 @@
 
 #define DISPATCH_VK_FUNC(func_name) dispatcher.func_name = reinterpret_cast<PFN_##func_name>(m_instance.getProcAddr(#func_name))
 
-extern "C" __declspec(dllexport) DnmGLLite::Context* LoadContext() {
+extern "C" SHARED_LIB_EXPORT DnmGLLite::Context* LoadContext() {
     return new DnmGLLite::Vulkan::Context();
 }
 
 namespace DnmGLLite::Vulkan {
     static const std::vector<const char*> required_extensions {
+    };
+
+    static const std::vector<const char*> required_present_extensions {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
@@ -238,18 +245,22 @@ namespace DnmGLLite::Vulkan {
         return out;
     }
 
-    bool CheckPhysicalDeviceFeatures(vk::PhysicalDevice physical_device, Context::SupportedFeatures& supported_features, std::string& out_message) {
+    bool CheckPhysicalDeviceFeatures(vk::PhysicalDevice physical_device, bool headless, Context::SupportedFeatures& supported_features, std::string& out_message) {
         vk::PhysicalDeviceMemoryPriorityFeaturesEXT memory_priorty{};
         vk::PhysicalDevicePageableDeviceLocalMemoryFeaturesEXT pageable_device_local_memory{};
         vk::PhysicalDeviceSynchronization2FeaturesKHR sync2{};
         vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing{};
+        vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore{};
+        vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering{};
         vk::PhysicalDeviceVulkan11Features features11{};
         vk::PhysicalDeviceFeatures2 features{};
 
+        memory_priorty.setPNext(&dynamic_rendering);
         pageable_device_local_memory.setPNext(&memory_priorty);
         sync2.setPNext(&pageable_device_local_memory);
         descriptor_indexing.setPNext(&sync2);
-        features11.setPNext(&descriptor_indexing);
+        timeline_semaphore.setPNext(&descriptor_indexing);
+        features11.setPNext(&timeline_semaphore);
         features.setPNext(&features11);
         physical_device.getFeatures2(&features);
 
@@ -269,6 +280,12 @@ namespace DnmGLLite::Vulkan {
             return false;
         }
 
+        if (const auto unsupported_exts = CheckDeviceExtensionSupport(physical_device, required_present_extensions);
+            !headless && !unsupported_exts.empty()) {
+            out_message = std::format("your gpu dont support this extensions: {}", unsupported_exts);
+            return false;
+        }
+
         supported_features.sampled_image_update_after_bind
             = descriptor_indexing.descriptorBindingSampledImageUpdateAfterBind;
 
@@ -295,6 +312,30 @@ namespace DnmGLLite::Vulkan {
 
         supported_features.memory_budget
             = CheckDeviceExtensionSupport(physical_device, "VK_EXT_memory_budget");
+
+        supported_features.timeline_semaphore
+            = timeline_semaphore.timelineSemaphore 
+            && CheckDeviceExtensionSupport(physical_device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+        supported_features.draw_indirect_count
+            = CheckDeviceExtensionSupport(physical_device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+        // depth stencil resolve and create renderpass2 are dependencies of the extension on vulkan 1.1
+        supported_features.dynamic_rendering
+            = dynamic_rendering.dynamicRendering
+            && CheckDeviceExtensionSupport(physical_device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)
+            && CheckDeviceExtensionSupport(physical_device, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME)
+            && CheckDeviceExtensionSupport(physical_device, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+
+        supported_features.bindless
+            = descriptor_indexing.runtimeDescriptorArray
+            && descriptor_indexing.descriptorBindingPartiallyBound
+            && descriptor_indexing.shaderSampledImageArrayNonUniformIndexing
+            && descriptor_indexing.shaderStorageBufferArrayNonUniformIndexing
+            && descriptor_indexing.shaderStorageImageArrayNonUniformIndexing
+            && supported_features.sampled_image_update_after_bind
+            && supported_features.storage_image_update_after_bind
+            && supported_features.storage_buffer_update_after_bind;
         
         return true;
     }
@@ -311,7 +352,27 @@ namespace DnmGLLite::Vulkan {
         if (m_empty_set_layout) m_device.destroy(m_empty_set_layout);
         if (placeholder_image) delete placeholder_image;
         if (placeholder_sampler) delete placeholder_sampler;
-        if (m_command_buffer) delete m_command_buffer;
+        for (auto& frame : m_frames) {
+            if (frame.command_buffer) delete frame.command_buffer;
+            if (frame.staging_buffer) delete frame.staging_buffer;
+            for (auto* secondary : frame.secondary_command_buffers) {
+                delete secondary;
+            }
+        }
+        for (auto& frame : m_compute_frames) {
+            if (frame.command_buffer) delete frame.command_buffer;
+        }
+        if (m_upload_engine) delete m_upload_engine;
+        m_upload_engine = nullptr;
+        // save the cache files
+        if (m_pipeline_cache) delete m_pipeline_cache;
+        if (m_shader_cache) delete m_shader_cache;
+
+        // headless views destroyed with their images
+        if (IsHeadless()) {
+            m_swapchain_image_views.clear();
+        }
+        m_offscreen_images.clear();
 
         DeleteVulkanObjects();
 
@@ -321,12 +382,29 @@ namespace DnmGLLite::Vulkan {
             m_device.destroy(image_view);    
         }
 
-        if (m_descriptor_pool) m_device.destroy(m_descriptor_pool);
-        if (m_command_pool) m_device.destroy(m_command_pool);
+        if (m_descriptor_allocator) delete m_descriptor_allocator;
+        if (m_bindless_table) delete m_bindless_table;
+        for (const auto& frame : m_frames) {
+            if (frame.command_pool) m_device.destroy(frame.command_pool);
+            if (frame.fence) m_device.destroy(frame.fence);
+            if (frame.acquire_next_image_semaphore) m_device.destroy(frame.acquire_next_image_semaphore);
+            if (frame.render_finished_semaphore) m_device.destroy(frame.render_finished_semaphore);
+            for (const auto pool : frame.secondary_command_pools) {
+                m_device.destroy(pool);
+            }
+        }
+        for (const auto& frame : m_compute_frames) {
+            if (frame.command_pool) m_device.destroy(frame.command_pool);
+            if (frame.fence) m_device.destroy(frame.fence);
+            if (frame.render_finished_semaphore) m_device.destroy(frame.render_finished_semaphore);
+        }
+        for (const auto& frame : m_frames) {
+            if (frame.timestamp_query_pool) m_device.destroy(frame.timestamp_query_pool);
+        }
+        for (const auto& timeline : m_ticket_timelines) {
+            if (timeline.semaphore) m_device.destroy(timeline.semaphore);
+        }
         if (m_swapchain) m_device.destroy(m_swapchain);
-        if (m_fence) m_device.destroy(m_fence);
-        if (m_acquire_next_image_semaphore) m_device.destroy(m_acquire_next_image_semaphore);
-        if (m_render_finished_semaphore) m_device.destroy(m_render_finished_semaphore);
         if (m_device) m_device.destroy();
         
         if (m_surface) m_instance.destroy(m_surface);
@@ -337,30 +415,57 @@ namespace DnmGLLite::Vulkan {
     }
     
     void Context::Init(const ContextDesc& desc) {
-        CreateInstance(GetWindowType(desc.window_handle));
+        const auto window_type = GetWindowType(desc.window_handle);
+        CreateInstance(window_type);
         if constexpr (_debug) CreateDebugMessenger();
-        CreateSurface(desc.window_handle);
+        if (window_type != WindowType::eNone) CreateSurface(desc.window_handle);
         CreateDevice();
-        CreateCommandPool();
-        CreateDescriptorPool();
-        CreateSwapchain(desc.window_extent, desc.Vsync);
+        CreateFrames(std::max(desc.frames_in_flight, 1u), desc.secondary_command_buffer_count);
+        CreateTimestampQueryPools(desc.gpu_scope_count);
+        m_descriptor_allocator = new DescriptorAllocator(*this);
+        if (desc.bindless) {
+            if (supported_features.bindless) {
+                m_bindless_table = new BindlessTable(*this, desc.bindless_buffer_count, desc.bindless_image_count, desc.bindless_sampler_count);
+            }
+            else {
+                Message("bindless not supported by device, resources have no bindless index", MessageType::eUnsupportedDevice);
+            }
+        }
         CreateVmaAllocator();
+        CreateStagingBuffers(desc.staging_buffer_size);
+        m_upload_engine = new UploadEngine(*this, desc.staging_buffer_size);
+        if (IsHeadless()) {
+            CreateOffscreenImages(desc.window_extent);
+        }
+        else {
+            CreateSwapchain(desc.window_extent, desc.Vsync);
+        }
+        m_shader_cache = new ShaderCache(*this, 
+            desc.pipeline_cache_path.empty() ? std::filesystem::path{} : desc.pipeline_cache_path.string() + ".shaders");
+        // presenting pipelines need swapchain format
+        m_pipeline_cache = new PipelineCache(*this, desc.pipeline_cache_path);
+        m_pipeline_cache->WarmUp();
         CreatePlaceholders();
     }
 
     void Context::CreateInstance(WindowType window_type) {
         std::vector<const char*> extensions;
-        extensions.emplace_back("VK_KHR_surface");
 
-        if constexpr (_os == OS::eWin) {
+        if (window_type == WindowType::eNone) {
+            // headless, no surface extensions
+        }
+        else if constexpr (_os == OS::eWin) {
+            extensions.emplace_back("VK_KHR_surface");
             extensions.emplace_back("VK_KHR_win32_surface");
         }
         else if constexpr (_os == OS::eAndroid) {
+            extensions.emplace_back("VK_KHR_surface");
             extensions.emplace_back("VK_KHR_android_surface");
         }
         else if constexpr (_os == OS::eLinux) {
             DnmGLLiteAssert((window_type == WindowType::eWayland) || (window_type == WindowType::eX11), "unsupported window manager")
 
+            extensions.emplace_back("VK_KHR_surface");
             if (window_type == WindowType::eWayland) {
                 extensions.emplace_back("VK_KHR_wayland_surface");
             }
@@ -419,6 +524,10 @@ namespace DnmGLLite::Vulkan {
             DISPATCH_VK_FUNC(vkCreateDebugUtilsMessengerEXT);
             DISPATCH_VK_FUNC(vkDestroyDebugUtilsMessengerEXT);
             DISPATCH_VK_FUNC(vkCmdPipelineBarrier2KHR);
+            DISPATCH_VK_FUNC(vkGetSemaphoreCounterValueKHR);
+            DISPATCH_VK_FUNC(vkWaitSemaphoresKHR);
+            DISPATCH_VK_FUNC(vkCmdDrawIndirectCountKHR);
+            DISPATCH_VK_FUNC(vkCmdDrawIndexedIndirectCountKHR);
         }
     }
     
@@ -438,7 +547,8 @@ namespace DnmGLLite::Vulkan {
     }
     
     void Context::CreateSurface(const WindowHandle& window_handle) {
-        auto win_type = GetWindowType(window_handle);
+#ifdef OS_WIN
+        DnmGLLiteAssert(GetWindowType(window_handle) == WindowType::eWindows, "unsupported window type")
         auto win_handle = std::get<WinWindowHandle>(window_handle);
 
         vk::Win32SurfaceCreateInfoKHR create_info{};
@@ -450,10 +560,18 @@ namespace DnmGLLite::Vulkan {
             (VkWin32SurfaceCreateInfoKHR*)&create_info, 
             {},
             (VkSurfaceKHR*)&m_surface);
+#else
+        //TODO: wayland, x11 and android surfaces
+        // a window was given, silently rendering headless would present nothing
+        DnmGLLiteAssert(false, "window surfaces only supported on windows, use a headless context (no window handle)")
+#endif
     }
     
     void Context::CreateDevice() {
         std::vector<const char*> extensions(required_extensions);
+        if (!IsHeadless()) {
+            extensions.insert(extensions.end(), required_present_extensions.begin(), required_present_extensions.end());
+        }
 
         if constexpr (_os == OS::eAndroid) 
             extensions.emplace_back("VK_ANDROID_external_memory_android_hardware_buffer");
@@ -467,7 +585,7 @@ namespace DnmGLLite::Vulkan {
         
         // TODO: choose best gpu
         for (auto& _device : physics_devices) { 
-            if (!CheckPhysicalDeviceFeatures(_device, supported_features, out))
+            if (!CheckPhysicalDeviceFeatures(_device, IsHeadless(), supported_features, out))
                 continue;
 
             m_physical_device = _device;
@@ -481,13 +599,17 @@ namespace DnmGLLite::Vulkan {
         vk::PhysicalDevicePageableDeviceLocalMemoryFeaturesEXT pageable_device_local_memory{};
         vk::PhysicalDeviceSynchronization2FeaturesKHR sync2{};
         vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing{};
+        vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore{};
+        vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering{};
         vk::PhysicalDeviceVulkan11Features features11{};
         vk::PhysicalDeviceFeatures2 features{};
 
+        memory_priorty.setPNext(&dynamic_rendering);
         pageable_device_local_memory.setPNext(&memory_priorty);
         sync2.setPNext(&pageable_device_local_memory);
         descriptor_indexing.setPNext(&sync2);
-        features11.setPNext(&descriptor_indexing);
+        timeline_semaphore.setPNext(&descriptor_indexing);
+        features11.setPNext(&timeline_semaphore);
         features.setPNext(&features11);
 
         features11.shaderDrawParameters = vk::True;
@@ -497,9 +619,16 @@ namespace DnmGLLite::Vulkan {
         descriptor_indexing.descriptorBindingStorageBufferUpdateAfterBind = supported_features.storage_buffer_update_after_bind;
         descriptor_indexing.descriptorBindingStorageImageUpdateAfterBind = supported_features.storage_image_update_after_bind;
         descriptor_indexing.descriptorBindingSampledImageUpdateAfterBind = supported_features.sampled_image_update_after_bind;
+        descriptor_indexing.runtimeDescriptorArray = supported_features.bindless;
+        descriptor_indexing.descriptorBindingPartiallyBound = supported_features.bindless;
+        descriptor_indexing.shaderSampledImageArrayNonUniformIndexing = supported_features.bindless;
+        descriptor_indexing.shaderStorageBufferArrayNonUniformIndexing = supported_features.bindless;
+        descriptor_indexing.shaderStorageImageArrayNonUniformIndexing = supported_features.bindless;
         memory_priorty.memoryPriority = supported_features.memory_priority;
         pageable_device_local_memory.pageableDeviceLocalMemory = supported_features.pageable_device_local_memory;
         sync2.synchronization2 = supported_features.sync2;
+        timeline_semaphore.timelineSemaphore = supported_features.timeline_semaphore;
+        dynamic_rendering.dynamicRendering = supported_features.dynamic_rendering;
 
         if (supported_features.sync2) {
             extensions.emplace_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
@@ -519,11 +648,24 @@ namespace DnmGLLite::Vulkan {
         if (supported_features.pageable_device_local_memory) {
             extensions.emplace_back(VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME);
         }
+        if (supported_features.timeline_semaphore) {
+            extensions.emplace_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        }
+        if (supported_features.draw_indirect_count) {
+            extensions.emplace_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
+        if (supported_features.dynamic_rendering) {
+            extensions.emplace_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+            extensions.emplace_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+            extensions.emplace_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        }
 
         Message(std::format("{}", std::string(supported_features)), MessageType::eInfo);
     
+        const auto queue_families = m_physical_device.getQueueFamilyProperties();
+
         uint32_t queue_family_index = 0;
-        for (auto queue_family : m_physical_device.getQueueFamilyProperties()) {
+        for (auto queue_family : queue_families) {
             if (queue_family.queueFlags & vk::QueueFlagBits::eGraphics) {
                 device_features.queue_flags = queue_family.queueFlags;
                 device_features.timestamp_valid_bits = queue_family.timestampValidBits;
@@ -533,15 +675,65 @@ namespace DnmGLLite::Vulkan {
             queue_family_index++;
         }
         device_features.queue_family = queue_family_index;
-    
-        float queue_priority = 1.0f;
-        vk::DeviceQueueCreateInfo queue_create_info;
-        queue_create_info.setPQueuePriorities(&queue_priority)
-        .setQueueFamilyIndex(device_features.queue_family)
-        .setQueueCount(1);
+
+        // how many queues used from each family
+        std::vector<uint32_t> queue_counts(queue_families.size(), 0);
+        queue_counts[device_features.queue_family] = 1;
+
+        // transfer only family (dma engine), otherwise second queue of graphics family, otherwise graphics queue itself
+        {
+            const auto is_transfer_only = [] (const vk::QueueFamilyProperties& family) {
+                return (family.queueFlags & vk::QueueFlagBits::eTransfer)
+                    && !(family.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))
+                    && family.minImageTransferGranularity == vk::Extent3D(1, 1, 1);
+            };
+
+            const auto it = std::ranges::find_if(queue_families, is_transfer_only);
+            if (it != queue_families.end()) {
+                device_features.transfer_queue_family = static_cast<uint32_t>(std::distance(queue_families.begin(), it));
+            }
+            else {
+                device_features.transfer_queue_family = device_features.queue_family;
+            }
+
+            auto& count = queue_counts[device_features.transfer_queue_family];
+            device_features.transfer_queue_index = std::min(count, queue_families[device_features.transfer_queue_family].queueCount - 1);
+            count = std::max(count, device_features.transfer_queue_index + 1);
+        }
+
+        // compute family without graphics (async compute), otherwise next queue of graphics family, otherwise graphics queue itself
+        {
+            const auto is_async_compute = [] (const vk::QueueFamilyProperties& family) {
+                return (family.queueFlags & vk::QueueFlagBits::eCompute)
+                    && !(family.queueFlags & vk::QueueFlagBits::eGraphics);
+            };
+
+            const auto it = std::ranges::find_if(queue_families, is_async_compute);
+            if (it != queue_families.end()) {
+                device_features.compute_queue_family = static_cast<uint32_t>(std::distance(queue_families.begin(), it));
+            }
+            else {
+                device_features.compute_queue_family = device_features.queue_family;
+            }
+
+            auto& count = queue_counts[device_features.compute_queue_family];
+            device_features.compute_queue_index = std::min(count, queue_families[device_features.compute_queue_family].queueCount - 1);
+            count = std::max(count, device_features.compute_queue_index + 1);
+        }
+
+        const std::vector<float> queue_priorities(std::ranges::max(queue_counts), 1.0f);
+        std::vector<vk::DeviceQueueCreateInfo> queue_create_infos{};
+        for (const auto i : Counter(queue_counts.size())) {
+            if (!queue_counts[i]) continue;
+
+            queue_create_infos.emplace_back(vk::DeviceQueueCreateInfo{}
+                .setPQueuePriorities(queue_priorities.data())
+                .setQueueFamilyIndex(i)
+                .setQueueCount(queue_counts[i]));
+        }
     
         vk::DeviceCreateInfo deviceCreateInfo;
-        deviceCreateInfo.setQueueCreateInfos(queue_create_info)
+        deviceCreateInfo.setQueueCreateInfos(queue_create_infos)
                         .setEnabledExtensionCount(extensions.size())
                         .setPEnabledExtensionNames(extensions)
                         .setPNext(&features);
@@ -549,34 +741,69 @@ namespace DnmGLLite::Vulkan {
         m_device = m_physical_device.createDevice(deviceCreateInfo);
         
         m_queue = m_device.getQueue(device_features.queue_family, 0);    
-        m_fence = m_device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
-        m_acquire_next_image_semaphore = m_device.createSemaphore({});
-        m_render_finished_semaphore = m_device.createSemaphore({});
+        m_transfer_queue = m_device.getQueue(device_features.transfer_queue_family, device_features.transfer_queue_index);
+        m_compute_queue = m_device.getQueue(device_features.compute_queue_family, device_features.compute_queue_index);
+
+        if (supported_features.dynamic_rendering) {
+            DISPATCH_VK_FUNC(vkCmdBeginRenderingKHR);
+            DISPATCH_VK_FUNC(vkCmdEndRenderingKHR);
+        }
+
+        // storage resources are shared with async compute without ownership transfers
+        if (device_features.compute_queue_family != device_features.queue_family) {
+            m_concurrent_queue_families = { device_features.queue_family, device_features.compute_queue_family };
+            if (device_features.transfer_queue_family != device_features.queue_family
+                && device_features.transfer_queue_family != device_features.compute_queue_family) {
+                m_concurrent_queue_families.emplace_back(device_features.transfer_queue_family);
+            }
+        }
     }
     
-    void Context::CreateCommandPool() {
+    void Context::CreateFrames(uint32_t frames_in_flight, uint32_t secondary_count) {
         vk::CommandPoolCreateInfo create_info{};
         create_info.setQueueFamilyIndex(device_features.queue_family);
-    
-        m_command_pool = m_device.createCommandPool(create_info);
-    
-        m_command_buffer = new CommandBuffer(*this);
-    }
 
-    void Context::CreateDescriptorPool() {
-        vk::DescriptorPoolSize pool_sizes[4];
-        pool_sizes[0].setType(vk::DescriptorType::eStorageBuffer).setDescriptorCount(512);
-        pool_sizes[1].setType(vk::DescriptorType::eUniformBuffer).setDescriptorCount(512);
-        pool_sizes[2].setType(vk::DescriptorType::eCombinedImageSampler).setDescriptorCount(512);
-        pool_sizes[3].setType(vk::DescriptorType::eStorageImage).setDescriptorCount(512);
+        m_frames.resize(frames_in_flight);
+        for (auto& frame : m_frames) {
+            frame.fence = m_device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+            frame.acquire_next_image_semaphore = m_device.createSemaphore({});
+            frame.render_finished_semaphore = m_device.createSemaphore({});
+            frame.command_pool = m_device.createCommandPool(create_info);
+            frame.command_buffer = new CommandBuffer(*this, frame.command_pool);
+
+            // recorded by worker threads, staging ring isn't thread safe
+            for ([[maybe_unused]] const auto i : Counter(secondary_count)) {
+                const auto pool = frame.secondary_command_pools.emplace_back(m_device.createCommandPool(create_info));
+                frame.secondary_command_buffers.emplace_back(
+                    new CommandBuffer(*this, pool, false, vk::CommandBufferLevel::eSecondary));
+            }
+            frame.command_buffer->m_secondaries = frame.secondary_command_buffers;
+        }
+
+        vk::CommandPoolCreateInfo compute_create_info{};
+        compute_create_info.setQueueFamilyIndex(device_features.compute_queue_family);
+
+        m_compute_frames.resize(frames_in_flight);
+        for (auto& frame : m_compute_frames) {
+            frame.fence = m_device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+            frame.render_finished_semaphore = m_device.createSemaphore({});
+            frame.command_pool = m_device.createCommandPool(compute_create_info);
+            // staging ring belongs to graphics frames
+            frame.command_buffer = new CommandBuffer(*this, frame.command_pool, false);
+            frame.command_buffer->m_compute_only = device_features.compute_queue_family != device_features.queue_family;
+        }
 
-        m_descriptor_pool = m_device.createDescriptorPool(
-            vk::DescriptorPoolCreateInfo{}
-                .setFlags({})
-                .setMaxSets(512)
-                .setPoolSizes(pool_sizes));
+        if (supported_features.timeline_semaphore) {
+            vk::SemaphoreTypeCreateInfoKHR type_create_info{};
+            type_create_info.setSemaphoreType(vk::SemaphoreType::eTimeline)
+                            .setInitialValue(0);
+
+            for (auto& timeline : m_ticket_timelines) {
+                timeline.semaphore = m_device.createSemaphore(vk::SemaphoreCreateInfo{}.setPNext(&type_create_info));
+            }
+        }
     }
-    
+
     void Context::CreateSwapchain(Uint2 extent, bool Vsync) {
         m_swapchain_properties = GetSupportedSwapchainProperties(m_physical_device, m_surface, extent, Vsync).or_else(
             [this] (auto error_str) -> std::expected<SwapchainProperties, std::string> {
@@ -629,6 +856,109 @@ namespace DnmGLLite::Vulkan {
         }
     }
     
+    void Context::CreateOffscreenImages(Uint2 extent) {
+        m_swapchain_properties = SwapchainProperties{
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .color_space = vk::ColorSpaceKHR::eSrgbNonlinear,
+            .present_mode = vk::PresentModeKHR::eImmediate,
+            .extent = vk::Extent2D(std::max(extent.x, 1u), std::max(extent.y, 1u)),
+            .image_count = static_cast<uint32_t>(m_frames.size()),
+        };
+        Message(std::format("{}", std::string(m_swapchain_properties)), MessageType::eInfo);
+
+        // one image per frame, so frame n never writes image gpu still reading from frame n - 1
+        for ([[maybe_unused]] const auto i : Counter(m_swapchain_properties.image_count)) {
+            auto& image = m_offscreen_images.emplace_back(std::make_unique<Vulkan::Image>(*this, DnmGLLite::ImageDesc{
+                .extent = {m_swapchain_properties.extent.width, m_swapchain_properties.extent.height, 1},
+                .format = static_cast<Format>(m_swapchain_properties.format),
+                .usage_flags = ImageUsageBits::eColorAttachment,
+                .type = ImageType::e2D,
+            }));
+
+            m_swapchain_images.emplace_back(image->GetImage());
+            m_swapchain_image_views.emplace_back(image->CreateGetImageView({}));
+        }
+    }
+
+    void Context::CreateStagingBuffers(uint32_t size) {
+        if (size == 0) return;
+
+        for (auto& frame : m_frames) {
+            frame.staging_buffer = new Vulkan::Buffer(*this, {
+                .size = size,
+                .memory_host_access = MemoryHostAccess::eWrite,
+                .memory_type = MemoryType::eHostMemory,
+                .buffer_flags = {},
+            });
+        }
+    }
+
+    void Context::CreateTimestampQueryPools(uint32_t scope_count) {
+        if (scope_count == 0 || device_features.timestamp_valid_bits == 0) return;
+
+        m_timestamp_period = m_physical_device.getProperties().limits.timestampPeriod;
+
+        vk::QueryPoolCreateInfo create_info{};
+        create_info.setQueryType(vk::QueryType::eTimestamp)
+                   .setQueryCount(scope_count * 2);
+
+        for (auto& frame : m_frames) {
+            frame.timestamp_query_pool = m_device.createQueryPool(create_info);
+            frame.command_buffer->m_timestamp_query_pool = frame.timestamp_query_pool;
+            frame.command_buffer->m_timestamp_query_count = scope_count * 2;
+        }
+    }
+
+    void Context::ResolveTimestamps(FrameData& frame) {
+        if (frame.timestamp_scopes.empty()) return;
+
+        const auto query_count = static_cast<uint32_t>(frame.timestamp_scopes.size() * 2);
+        const auto results = m_device.getQueryPoolResults<uint64_t>(
+            frame.timestamp_query_pool, 
+            0, 
+            query_count, 
+            query_count * sizeof(uint64_t), 
+            sizeof(uint64_t), 
+            vk::QueryResultFlagBits::e64);
+
+        // not ready only if a scope was never executed, keep the previous timings
+        if (results.result == vk::Result::eSuccess) {
+            const auto valid_bits = device_features.timestamp_valid_bits;
+            const uint64_t mask = valid_bits >= 64 ? UINT64_MAX : (uint64_t(1) << valid_bits) - 1;
+
+            m_gpu_scope_timings.clear();
+            for (const auto& scope : frame.timestamp_scopes) {
+                const auto ticks = (results.value[scope.end_query] - results.value[scope.begin_query]) & mask;
+                m_gpu_scope_timings.emplace_back(
+                    scope.name, 
+                    scope.depth, 
+                    static_cast<float>(static_cast<double>(ticks) * m_timestamp_period / 1'000'000.0));
+            }
+        }
+        frame.timestamp_scopes.clear();
+    }
+
+    std::optional<Context::StagingAllocation> Context::AllocateStaging(uint32_t size, uint32_t alignment) {
+        auto& frame = m_frames[m_frame_index];
+        if (!frame.staging_buffer) return std::nullopt;
+
+        // not a power of two for 3 component formats
+        const uint32_t offset = (frame.staging_offset + alignment - 1) / alignment * alignment;
+        if (uint64_t(offset) + size > frame.staging_buffer->GetDesc().size) return std::nullopt;
+
+        frame.staging_offset = offset + size;
+        return StagingAllocation{
+            .buffer = frame.staging_buffer,
+            .offset = offset,
+            .mapped_ptr = frame.staging_buffer->GetMappedPtr() + offset,
+        };
+    }
+
+    DnmGLLite::Image* Context::GetRenderTargetImage() const noexcept {
+        if (!IsHeadless()) return nullptr;
+        return m_offscreen_images[m_last_render_image_index].get();
+    }
+    
     void Context::CreateVmaAllocator() {
         VmaAllocatorCreateFlags create_flag_bits
             = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT | VMA_ALLOCATOR_CREATE_EXTERNALLY_SYNCHRONIZED_BIT;
@@ -655,59 +985,365 @@ namespace DnmGLLite::Vulkan {
                 MessageType::eGraphicsBackendInternal);
     }
     
-    void Context::ExecuteCommands(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) {
-        [[maybe_unused]] auto result 
-            = m_device.waitForFences({m_fence}, vk::True, 1'000'000'000);
+    Context::FrameData& Context::WaitForNextFrame() {
+        m_frame_index = (m_frame_index + 1) % m_frames.size();
+        auto& frame = m_frames[m_frame_index];
+
+        const auto result 
+            = m_device.waitForFences({frame.fence}, vk::True, 1'000'000'000);
     
         if (result == vk::Result::eTimeout) {
             std::println("timeout");
         }
 
-        m_device.resetFences({m_fence});
+        // offscreen ring follows frames
+        if (IsHeadless()) m_image_index = m_frame_index;
+        frame.staging_offset = 0;
+
+        const auto completed_ticket = GetCompletedRetireTicket();
+        DeleteVulkanObjects(completed_ticket);
+        m_descriptor_allocator->Collect(completed_ticket);
+        if (m_bindless_table) m_bindless_table->Collect(completed_ticket);
+        return frame;
+    }
 
+    void Context::FreeDescriptorSets(DescriptorAllocation&& allocation) {
+        for (const auto set : allocation.sets) {
+            m_descriptor_set_tickets.erase(static_cast<VkDescriptorSet>(set));
+            // owner destroys its templates right after
+            std::erase_if(defer_template_updates, [set] (const InternalTemplateUpdate& update) { return update.set == set; });
+        }
+        m_descriptor_allocator->Free(std::move(allocation), GetRetireTicket());
+    }
+
+    Context::RetireTicket Context::GetRetireTicket() const {
+        return {
+            .queue_values = {
+                m_ticket_timelines[static_cast<uint32_t>(QueueType::eGraphics)].counter + 1,
+                m_ticket_timelines[static_cast<uint32_t>(QueueType::eCompute)].counter + m_compute_recording,
+            },
+            // upload engine deletes its own buffers after it
+            .upload_value = m_upload_engine ? m_upload_engine->GetRetireValue() : 0,
+        };
+    }
+
+    Context::RetireTicket Context::GetCompletedRetireTicket() {
+        return {
+            .queue_values = {
+                GetCompletedTicketValue(QueueType::eGraphics),
+                GetCompletedTicketValue(QueueType::eCompute),
+            },
+            .upload_value = m_upload_engine ? m_upload_engine->GetCompletedValue() : 0,
+        };
+    }
+
+    void Context::DestroyObject(const DeletedObject& object) {
+        const auto handle = object.handle;
+        switch (object.type) {
+            case vk::ObjectType::eBuffer: 
+                vmaDestroyBuffer(m_vma_allocator, std::bit_cast<VkBuffer>(handle), object.allocation); break;
+            case vk::ObjectType::eImage: 
+                vmaDestroyImage(m_vma_allocator, std::bit_cast<VkImage>(handle), object.allocation); break;
+            case vk::ObjectType::eImageView: m_device.destroy(vk::ImageView(std::bit_cast<VkImageView>(handle))); break;
+            case vk::ObjectType::eSampler: m_device.destroy(vk::Sampler(std::bit_cast<VkSampler>(handle))); break;
+            case vk::ObjectType::eShaderModule: m_device.destroy(vk::ShaderModule(std::bit_cast<VkShaderModule>(handle))); break;
+            case vk::ObjectType::ePipeline: m_device.destroy(vk::Pipeline(std::bit_cast<VkPipeline>(handle))); break;
+            case vk::ObjectType::ePipelineLayout: m_device.destroy(vk::PipelineLayout(std::bit_cast<VkPipelineLayout>(handle))); break;
+            case vk::ObjectType::eRenderPass: m_device.destroy(vk::RenderPass(std::bit_cast<VkRenderPass>(handle))); break;
+            case vk::ObjectType::eFramebuffer: m_device.destroy(vk::Framebuffer(std::bit_cast<VkFramebuffer>(handle))); break;
+            case vk::ObjectType::eDescriptorSetLayout: 
+                m_device.destroy(vk::DescriptorSetLayout(std::bit_cast<VkDescriptorSetLayout>(handle))); break;
+            case vk::ObjectType::eDeviceMemory: vmaFreeMemory(m_vma_allocator, object.allocation); break;
+            default: 
+                DnmGLLiteAssert(false, "deferred delete of {} not supported", vk::to_string(object.type))
+        }
+    }
+
+    void Context::BeginFrameRecording(FrameData& frame) {
         ProcessResourceUpdates();
-        DeleteVulkanObjects();
 
-        m_device.resetCommandPool(m_command_pool);
-        m_command_buffer->command_buffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        // transfer queue works while this frame recording
+        m_upload_engine->Flush();
+
+        m_device.resetCommandPool(frame.command_pool);
+        for (const auto pool : frame.secondary_command_pools) {
+            m_device.resetCommandPool(pool);
+        }
+        frame.command_buffer->BeginVk({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
         context_state = ContextState::eCommandBufferRecording;
+
+        ResolveTimestamps(frame);
+        frame.command_buffer->m_timestamp_scopes.clear();
+        if (frame.timestamp_query_pool) {
+            frame.command_buffer->command_buffer.resetQueryPool(
+                frame.timestamp_query_pool, 0, frame.command_buffer->m_timestamp_query_count);
+        }
+
+        m_upload_engine->RecordAcquire(frame.command_buffer->command_buffer);
         ProcressImageLayoutTransfer();
-        if (!func(m_command_buffer)) {
-            m_command_buffer->End();
-            return;
+    }
+
+    GpuTicket Context::SubmitFrame(FrameData& frame, const vk::SubmitInfo& submit_info) {
+        auto& timeline = GetTicketTimeline(QueueType::eGraphics);
+        const uint64_t ticket_value = ++timeline.counter;
+        frame.ticket_value = ticket_value;
+        RecordDescriptorSetUse(*frame.command_buffer, QueueType::eGraphics, ticket_value);
+
+        // only scopes of submitted frames resolved, a skipped frame can leave old results in the pool
+        frame.timestamp_scopes = std::move(frame.command_buffer->m_timestamp_scopes);
+        frame.command_buffer->m_timestamp_scopes.clear();
+
+        // no-op for host coherent memory
+        if (frame.staging_offset) {
+            vmaFlushAllocation(m_vma_allocator, frame.staging_buffer->GetAllocation(), 0, frame.staging_offset);
+        }
+
+        // fence reset just before submit, so a skipped frame never leaves it unsignaled
+        m_device.resetFences({frame.fence});
+
+        std::vector<vk::Semaphore> wait_semaphores(
+            submit_info.pWaitSemaphores, submit_info.pWaitSemaphores + submit_info.waitSemaphoreCount);
+        std::vector<vk::PipelineStageFlags> wait_stages(
+            submit_info.pWaitDstStageMask, submit_info.pWaitDstStageMask + submit_info.waitSemaphoreCount);
+        std::vector<vk::Semaphore> signal_semaphores(
+            submit_info.pSignalSemaphores, submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+
+        // copies acquired at the start of this frame
+        if (const auto upload_semaphore = m_upload_engine->GetWaitSemaphore()) {
+            wait_semaphores.emplace_back(upload_semaphore);
+            wait_stages.emplace_back(vk::PipelineStageFlagBits::eAllCommands);
+            m_upload_engine->OnGraphicsSubmit();
+        }
+
+        // compute results used by this frame, waited before anything touches them
+        for (const auto compute_semaphore : m_pending_compute_semaphores) {
+            wait_semaphores.emplace_back(compute_semaphore);
+            wait_stages.emplace_back(vk::PipelineStageFlagBits::eAllCommands);
+        }
+        m_pending_compute_semaphores.clear();
+
+        // binary semaphores ignore their values
+        std::vector<uint64_t> wait_values(wait_semaphores.size(), 0);
+        std::vector<uint64_t> signal_values(signal_semaphores.size(), 0);
+        vk::TimelineSemaphoreSubmitInfoKHR timeline_info{};
+        if (timeline.semaphore) {
+            signal_semaphores.emplace_back(timeline.semaphore);
+            signal_values.emplace_back(ticket_value);
+            timeline_info.setWaitSemaphoreValues(wait_values)
+                         .setSignalSemaphoreValues(signal_values);
+        }
+
+        auto final_submit_info = submit_info;
+        final_submit_info.setWaitSemaphores(wait_semaphores)
+                         .setWaitDstStageMask(wait_stages)
+                         .setSignalSemaphores(signal_semaphores)
+                         .setPNext(timeline.semaphore ? &timeline_info : nullptr);
+
+        m_queue.submit({final_submit_info}, frame.fence);
+
+        context_state = ContextState::eCommandExecuting;
+
+        return GpuTicket(this, ticket_value);
+    }
+
+    uint64_t Context::GetCompletedTicketValue(QueueType queue) {
+        auto& timeline = GetTicketTimeline(queue);
+        if (timeline.semaphore) {
+            timeline.completed = m_device.getSemaphoreCounterValueKHR(timeline.semaphore, dispatcher);
+            return timeline.completed;
+        }
+
+        // fences of one queue signal in submit order
+        for (const auto& frame : GetQueueFrames(queue)) {
+            if (frame.ticket_value > timeline.completed 
+                && m_device.getFenceStatus(frame.fence) == vk::Result::eSuccess) {
+                timeline.completed = frame.ticket_value;
+            }
+        }
+        return timeline.completed;
+    }
+
+    bool Context::IsTicketComplete(uint64_t value, QueueType queue) {
+        return value <= GetTicketTimeline(queue).completed || value <= GetCompletedTicketValue(queue);
+    }
+
+    bool Context::WaitTicket(uint64_t value, QueueType queue, uint64_t timeout_ns) {
+        if (IsTicketComplete(value, queue)) return true;
+
+        if (const auto semaphore = GetTicketTimeline(queue).semaphore) {
+            vk::SemaphoreWaitInfoKHR wait_info{};
+            wait_info.setSemaphores(semaphore)
+                     .setValues(value);
+
+            return m_device.waitSemaphoresKHR(wait_info, timeout_ns, dispatcher) == vk::Result::eSuccess;
+        }
+
+        // older frame of the ring already waited before its slot reused, so the oldest frame at or after value is enough
+        const FrameData* wait_frame = nullptr;
+        for (const auto& frame : GetQueueFrames(queue)) {
+            if (frame.ticket_value >= value && (!wait_frame || frame.ticket_value < wait_frame->ticket_value)) {
+                wait_frame = &frame;
+            }
+        }
+        if (!wait_frame) return true;
+
+        return m_device.waitForFences({wait_frame->fence}, vk::True, timeout_ns) == vk::Result::eSuccess;
+    }
+
+    void Context::ResumeOnTicketComplete(uint64_t value, QueueType queue, std::coroutine_handle<> handle) {
+        m_ticket_waiters.emplace_back(value, queue, handle);
+    }
+
+    void Context::PollTickets() {
+        if (m_ticket_waiters.empty()) return;
+
+        const uint64_t completed[] = {
+            GetCompletedTicketValue(QueueType::eGraphics),
+            GetCompletedTicketValue(QueueType::eCompute),
+        };
+
+        // resumed coroutines can submit or co_await again, so take them out first
+        std::vector<std::coroutine_handle<>> ready{};
+        std::erase_if(m_ticket_waiters, [&ready, &completed] (const TicketWaiter& waiter) {
+            if (waiter.value > completed[static_cast<uint32_t>(waiter.queue)]) return false;
+            ready.emplace_back(waiter.handle);
+            return true;
+        });
+
+        for (auto handle : ready) {
+            handle.resume();
+        }
+    }
+
+    void Context::WaitPendingComputeSemaphores() {
+        if (m_pending_compute_semaphores.empty()) return;
+
+        // empty submit, only consumes the semaphore signals
+        const std::vector<vk::PipelineStageFlags> wait_stages(
+            m_pending_compute_semaphores.size(), vk::PipelineStageFlagBits::eAllCommands);
+
+        vk::SubmitInfo submit_info{};
+        submit_info.setWaitSemaphores(m_pending_compute_semaphores)
+                   .setWaitDstStageMask(wait_stages);
+
+        m_queue.submit({submit_info});
+        m_pending_compute_semaphores.clear();
+    }
+
+    GpuTicket Context::ExecuteComputeAsync(const std::function<bool(DnmGLLite::CommandBuffer*)>& func, GpuTicket wait_ticket) {
+        PollTickets();
+
+        m_compute_frame_index = (m_compute_frame_index + 1) % m_compute_frames.size();
+        auto& frame = m_compute_frames[m_compute_frame_index];
+
+        [[maybe_unused]] auto _ = m_device.waitForFences(frame.fence, vk::True, UINT64_MAX);
+
+        // no graphics submit waited this slot's semaphore, it can't be signaled again before that
+        if (std::ranges::contains(m_pending_compute_semaphores, frame.render_finished_semaphore)) {
+            WaitPendingComputeSemaphores();
+        }
+
+        m_device.resetCommandPool(frame.command_pool);
+        frame.command_buffer->BeginVk({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+        m_compute_recording = true;
+        const bool submit = func(frame.command_buffer);
+        m_compute_recording = false;
+        frame.command_buffer->End();
+        if (!submit) return {};
+
+        auto& timeline = GetTicketTimeline(QueueType::eCompute);
+        const uint64_t ticket_value = ++timeline.counter;
+        frame.ticket_value = ticket_value;
+        RecordDescriptorSetUse(*frame.command_buffer, QueueType::eCompute, ticket_value);
+
+        std::vector<vk::Semaphore> signal_semaphores{ frame.render_finished_semaphore };
+        std::vector<uint64_t> signal_values{ 0 };
+        vk::TimelineSemaphoreSubmitInfoKHR timeline_info{};
+        if (timeline.semaphore) {
+            signal_semaphores.emplace_back(timeline.semaphore);
+            signal_values.emplace_back(ticket_value);
+            timeline_info.setSignalSemaphoreValues(signal_values);
         }
-        m_command_buffer->End();
+
+        // graphics work sharing storage resources, waited on the cpu without timeline semaphores
+        std::vector<vk::Semaphore> wait_semaphores{};
+        std::vector<uint64_t> wait_values{};
+        std::vector<vk::PipelineStageFlags> wait_stages{};
+        if (wait_ticket.GetValue()) {
+            DnmGLLiteAssert(wait_ticket.GetQueue() == QueueType::eGraphics, "ExecuteComputeAsync waits tickets of ExecuteCommands/Render")
+            if (const auto graphics_semaphore = GetTicketTimeline(QueueType::eGraphics).semaphore) {
+                wait_semaphores.emplace_back(graphics_semaphore);
+                wait_values.emplace_back(wait_ticket.GetValue());
+                wait_stages.emplace_back(vk::PipelineStageFlagBits::eAllCommands);
+                timeline_info.setWaitSemaphoreValues(wait_values);
+            }
+            else {
+                WaitTicket(wait_ticket.GetValue(), QueueType::eGraphics, UINT64_MAX);
+            }
+        }
+
+        vk::SubmitInfo submit_info{};
+        submit_info.setCommandBuffers(frame.command_buffer->command_buffer)
+                   .setWaitSemaphores(wait_semaphores)
+                   .setWaitDstStageMask(wait_stages)
+                   .setSignalSemaphores(signal_semaphores)
+                   .setPNext(timeline.semaphore ? &timeline_info : nullptr);
+
+        m_device.resetFences({frame.fence});
+        m_compute_queue.submit({submit_info}, frame.fence);
+
+        // next graphics submit waits it
+        m_pending_compute_semaphores.emplace_back(frame.render_finished_semaphore);
+
+        return GpuTicket(this, ticket_value, QueueType::eCompute);
+    }
+
+    GpuTicket Context::ExecuteCommands(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) {
+        PollTickets();
+
+        auto& frame = WaitForNextFrame();
+        BeginFrameRecording(frame);
+
+        if (!func(frame.command_buffer)) {
+            frame.command_buffer->End();
+            context_state = ContextState::eCommandExecuting;
+            return {};
+        }
+        frame.command_buffer->End();
     
         const vk::SubmitInfo submit_info(
             {},
             {},
             {},
             1,
-            &m_command_buffer->command_buffer,
+            &frame.command_buffer->command_buffer,
             0,
             nullptr,
             {}
         );
 
-        m_queue.submit({submit_info}, m_fence);
-        context_state = ContextState::eCommandExecuting;
+        return SubmitFrame(frame, submit_info);
     }
 
-    void Context::Render(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) {
-        {
-            const auto result 
-                = m_device.waitForFences({m_fence}, vk::True, 1'000'000'000);
-        
-            if (result == vk::Result::eTimeout) {
-                std::println("timeout");
-            }
-            m_device.resetFences({m_fence});
+    GpuTicket Context::Render(const std::function<bool(DnmGLLite::CommandBuffer*)>& func) {
+        // nothing to acquire or present
+        if (IsHeadless()) {
+            auto ticket = ExecuteCommands(func);
+            // readbacks in later ExecuteCommands move m_image_index to their own frame
+            if (ticket.GetValue()) m_last_render_image_index = m_image_index;
+            return ticket;
         }
 
+        PollTickets();
+
+        auto& frame = WaitForNextFrame();
+        GpuTicket ticket{};
+
         //get the next image
         {
             const auto result 
-                = m_device.acquireNextImageKHR(m_swapchain, 1'000'000'000, m_acquire_next_image_semaphore, nullptr);
+                = m_device.acquireNextImageKHR(m_swapchain, 1'000'000'000, frame.acquire_next_image_semaphore, nullptr);
 
             if (result.result == vk::Result::eErrorDeviceLost) {
                 // TODO: make better log
@@ -725,40 +1361,35 @@ namespace DnmGLLite::Vulkan {
             m_image_index = result.value;
         }
 
-        ProcessResourceUpdates();
-        DeleteVulkanObjects();
-
         {
-            m_device.resetCommandPool(m_command_pool);
-            m_command_buffer->command_buffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
-            context_state = ContextState::eCommandBufferRecording;
-            ProcressImageLayoutTransfer();
-            if (!func(m_command_buffer)) {
-                m_command_buffer->End();
-                return;
+            BeginFrameRecording(frame);
+            if (!func(frame.command_buffer)) {
+                frame.command_buffer->End();
+                context_state = ContextState::eCommandExecuting;
+                return ticket;
             }
-            m_command_buffer->End();
+            frame.command_buffer->End();
 
             constexpr vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
         
             const vk::SubmitInfo submit_info(
                 1,
-                &m_acquire_next_image_semaphore,
+                &frame.acquire_next_image_semaphore,
                 &wait_stage,
                 1,
-                &m_command_buffer->command_buffer,
+                &frame.command_buffer->command_buffer,
                 1,
-                &m_render_finished_semaphore,
+                &frame.render_finished_semaphore,
                 {}
             );
         
-            m_queue.submit({submit_info}, m_fence);
+            ticket = SubmitFrame(frame, submit_info);
         }
 
         //Present image
         {
             vk::PresentInfoKHR present_info{};
-            present_info.setWaitSemaphores(m_render_finished_semaphore);
+            present_info.setWaitSemaphores(frame.render_finished_semaphore);
             present_info.setImageIndices(m_image_index);
             present_info.setSwapchains(m_swapchain);
     
@@ -777,7 +1408,8 @@ namespace DnmGLLite::Vulkan {
                 Message("failed to presenting", MessageType::eUnknown);
             }
         }
-        context_state = ContextState::eCommandExecuting;
+
+        return ticket;
     }
 
     void Context::ProcressImageLayoutTransfer() {
@@ -796,47 +1428,106 @@ namespace DnmGLLite::Vulkan {
             i++;
         }
 
-        m_command_buffer->TransferImageLayout(layout_transfer_array);
+        m_frames[m_frame_index].command_buffer->TransferImageLayout(layout_transfer_array);
         defer_image_layout_transfer_array.resize(0);
     }
 
+    // keeps the last write of every array element and merges consecutive elements of a binding into one write.
+    // infos must have capacity for every update, writes point into it
+    template <typename Resource, typename Info>
+    static void CoalesceResourceUpdates(
+        Context& context, std::vector<Resource>& updates, std::vector<Info>& infos, std::vector<vk::WriteDescriptorSet>& writes) {
+        // latest first, so stable sort and unique keep it
+        std::ranges::reverse(updates);
+        const auto destination = [] (const Resource& res) { return std::tuple(res.set, res.binding, res.array_element); };
+        std::ranges::stable_sort(updates, {}, destination);
+        const auto [first, last] = std::ranges::unique(updates, {}, destination);
+        updates.erase(first, last);
+
+        for (const auto& res : updates) {
+            auto& info = infos.emplace_back();
+            vk::WriteDescriptorSet write{};
+            context.ProcessResource(res, info, write);
+
+            if (!writes.empty()) {
+                auto& prev = writes.back();
+                if (prev.dstSet == write.dstSet && prev.dstBinding == write.dstBinding
+                    && prev.descriptorType == write.descriptorType
+                    && prev.dstArrayElement + prev.descriptorCount == write.dstArrayElement) {
+                    // infos of prev are right before info
+                    ++prev.descriptorCount;
+                    continue;
+                }
+            }
+            writes.emplace_back(write);
+        }
+    }
+
+    void Context::RecordDescriptorSetUse(CommandBuffer& command_buffer, QueueType queue, uint64_t ticket_value) {
+        for (const auto set : command_buffer.m_used_sets) {
+            m_descriptor_set_tickets[static_cast<VkDescriptorSet>(set)][static_cast<uint32_t>(queue)] = ticket_value;
+        }
+        command_buffer.m_used_sets.clear();
+    }
+
+    void Context::DeferResourceUpdate(InternalTemplateUpdate&& update) {
+        const auto same_set = [set = update.set] (const auto& res) { return res.set == set; };
+        std::erase_if(defer_buffer_updates, same_set);
+        std::erase_if(defer_image_updates, same_set);
+        std::erase_if(defer_texture_updates, same_set);
+        std::erase_if(defer_template_updates, same_set);
+        defer_template_updates.emplace_back(std::move(update));
+    }
+
     void Context::ProcessResourceUpdates() {
+        if (defer_buffer_updates.empty() && defer_image_updates.empty() && defer_texture_updates.empty() 
+            && defer_template_updates.empty()) return;
+
+        // sets can still be bound by frames in flight, waits only the last submits that bound them
+        std::array<uint64_t, 2> wait_tickets{};
+        const auto add_set = [&] (vk::DescriptorSet set) {
+            const auto it = m_descriptor_set_tickets.find(static_cast<VkDescriptorSet>(set));
+            if (it == m_descriptor_set_tickets.end()) return;
+            for (uint32_t queue = 0; queue < wait_tickets.size(); ++queue) {
+                wait_tickets[queue] = std::max(wait_tickets[queue], it->second[queue]);
+            }
+        };
+        for (const auto& res : defer_buffer_updates) add_set(res.set);
+        for (const auto& res : defer_image_updates) add_set(res.set);
+        for (const auto& res : defer_texture_updates) add_set(res.set);
+        for (const auto& update : defer_template_updates) add_set(update.set);
+        for (uint32_t queue = 0; queue < wait_tickets.size(); ++queue) {
+            if (wait_tickets[queue]) WaitTicket(wait_tickets[queue], static_cast<QueueType>(queue), UINT64_MAX);
+        }
+
+        for (const auto& update : defer_template_updates) {
+            m_device.updateDescriptorSetWithTemplate(update.set, update.update_template, update.data.data());
+        }
+        defer_template_updates.resize(0);
+
         std::vector<vk::WriteDescriptorSet> writes{};
         std::vector<vk::DescriptorImageInfo> image_infos{};
         std::vector<vk::DescriptorBufferInfo> buffer_infos{};
 
-        writes.reserve(defer_resource_update.size());
-        image_infos.reserve(defer_resource_update.size());
-        buffer_infos.reserve(defer_resource_update.size());
+        writes.reserve(defer_buffer_updates.size() + defer_image_updates.size() + defer_texture_updates.size());
+        image_infos.reserve(defer_image_updates.size() + defer_texture_updates.size());
+        buffer_infos.reserve(defer_buffer_updates.size());
 
-        for (const auto& descriptor : defer_resource_update) {
-            std::visit([&writes, &image_infos, &buffer_infos, this] (auto&& res) {
-                using T = std::decay_t<decltype(res)>;
-                if constexpr (std::is_same_v<T, InternalBufferResource>) {
-                    ProcessResource(res, buffer_infos.emplace_back(), writes.emplace_back());
-                }
-                else if constexpr (std::is_same_v<T, InternalImageResource>) {
-                    ProcessResource(res, image_infos.emplace_back(), writes.emplace_back());
-                }
-                else if constexpr (std::is_same_v<T, InternalTextureResource>) {
-                    ProcessResource(res, image_infos.emplace_back(), writes.emplace_back());
-                }
-            }, descriptor);
-        }
+        CoalesceResourceUpdates(*this, defer_buffer_updates, buffer_infos, writes);
+        CoalesceResourceUpdates(*this, defer_image_updates, image_infos, writes);
+        CoalesceResourceUpdates(*this, defer_texture_updates, image_infos, writes);
 
         m_device.updateDescriptorSets(writes, {});
 
-        defer_resource_update.resize(0);
+        defer_buffer_updates.resize(0);
+        defer_image_updates.resize(0);
+        defer_texture_updates.resize(0);
     }
 
     void Context::CreatePlaceholders() {
         m_empty_set_layout = m_device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo{}.setBindingCount(0));
-        m_empty_set 
-            = m_device.allocateDescriptorSets(
-                vk::DescriptorSetAllocateInfo{}
-                    .setSetLayouts(m_empty_set_layout)
-                    .setDescriptorSetCount(1)
-                    .setDescriptorPool(m_descriptor_pool))[0];
+        // never freed, lives until the allocator destroys its pools
+        m_empty_set = m_descriptor_allocator->Allocate({&m_empty_set_layout, 1}, {}).sets[0];
 
         placeholder_image = new DnmGLLite::Vulkan::Image(*this, {
             .extent = {1, 1, 1},
@@ -866,6 +1557,46 @@ namespace DnmGLLite::Vulkan {
         return std::make_unique<DnmGLLite::Vulkan::Image>(*this, desc);
     }
 
+    std::vector<std::unique_ptr<DnmGLLite::Image>> Context::CreateAliasedImages(std::span<const DnmGLLite::ImageDesc> descs) noexcept {
+        std::vector<std::unique_ptr<DnmGLLite::Image>> images{};
+        images.reserve(descs.size());
+
+        VkMemoryRequirements memory_requirements{};
+        memory_requirements.memoryTypeBits = UINT32_MAX;
+        for (const auto& desc : descs) {
+            const auto requirements = Vulkan::Image::GetMemoryRequirements(*this, desc);
+            memory_requirements.size = std::max(memory_requirements.size, requirements.size);
+            memory_requirements.alignment = std::max(memory_requirements.alignment, requirements.alignment);
+            memory_requirements.memoryTypeBits &= requirements.memoryTypeBits;
+        }
+
+        VmaAllocation vma_allocation = nullptr;
+        if (descs.size() > 1 && memory_requirements.memoryTypeBits) {
+            VmaAllocationCreateInfo alloc_create_info{};
+            alloc_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            alloc_create_info.priority = 1.f;
+            // on failure allocation stays null
+            vmaAllocateMemory(m_vma_allocator, &memory_requirements, &alloc_create_info, &vma_allocation, nullptr);
+        }
+
+        // no common memory type or out of memory, images get their own memory
+        if (!vma_allocation) {
+            for (const auto& desc : descs) {
+                images.emplace_back(CreateImage(desc));
+            }
+            return images;
+        }
+
+        // owned by the images together, freed after the last one in any destruction order
+        const std::shared_ptr<VmaAllocation_T> allocation(vma_allocation, [this] (VmaAllocation allocation) {
+            DeleteAllocation(allocation);
+        });
+        for (const auto& desc : descs) {
+            images.emplace_back(std::make_unique<DnmGLLite::Vulkan::Image>(*this, desc, allocation));
+        }
+        return images;
+    }
+
     std::unique_ptr<DnmGLLite::Sampler> Context::CreateSampler(const DnmGLLite::SamplerDesc& desc) noexcept {
         return std::make_unique<DnmGLLite::Vulkan::Sampler>(*this, desc);
     }
@@ -879,10 +1610,40 @@ namespace DnmGLLite::Vulkan {
     }
 
     std::unique_ptr<DnmGLLite::ComputePipeline> Context::CreateComputePipeline(const DnmGLLite::ComputePipelineDesc& desc) noexcept {
-        return std::make_unique<DnmGLLite::Vulkan::ComputePipeline>(*this, desc);
+        auto pipeline = std::make_unique<DnmGLLite::Vulkan::ComputePipeline>(*this, desc);
+        m_pipeline_cache->Record(desc);
+        return pipeline;
     }
 
     std::unique_ptr<DnmGLLite::GraphicsPipeline> Context::CreateGraphicsPipeline(const DnmGLLite::GraphicsPipelineDesc& desc) noexcept {
-        return std::make_unique<DnmGLLite::Vulkan::GraphicsPipeline>(*this, desc);
+        auto pipeline = std::make_unique<DnmGLLite::Vulkan::GraphicsPipeline>(*this, desc);
+        m_pipeline_cache->Record(desc);
+        return pipeline;
+    }
+
+    std::unique_ptr<DnmGLLite::ComputePipeline> Context::CreateComputePipelineAsync(const DnmGLLite::ComputePipelineDesc& desc) noexcept {
+        auto pipeline = std::make_unique<DnmGLLite::Vulkan::ComputePipeline>(*this, desc, true);
+        m_pipeline_cache->Record(desc);
+        m_pipeline_cache->Submit([typed_pipeline = pipeline.get()] { typed_pipeline->Compile(); });
+        return pipeline;
+    }
+
+    std::unique_ptr<DnmGLLite::GraphicsPipeline> Context::CreateGraphicsPipelineAsync(const DnmGLLite::GraphicsPipelineDesc& desc) noexcept {
+        auto pipeline = std::make_unique<DnmGLLite::Vulkan::GraphicsPipeline>(*this, desc, true);
+        m_pipeline_cache->Record(desc);
+        m_pipeline_cache->Submit([typed_pipeline = pipeline.get()] { typed_pipeline->Compile(); });
+        return pipeline;
+    }
+
+    vk::PipelineCache Context::GetPipelineCache() const {
+        return m_pipeline_cache->GetPipelineCache();
+    }
+
+    void Context::UploadDataAsync(const DnmGLLite::Buffer* buffer, const void* data, uint32_t size, uint32_t offset) {
+        m_upload_engine->UploadData(static_cast<const Vulkan::Buffer*>(buffer), data, size, offset);
+    }
+
+    void Context::UploadDataAsync(DnmGLLite::Image* image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset) {
+        m_upload_engine->UploadData(static_cast<Vulkan::Image*>(image), subresource, data, size, offset);
     }
 } // namespace DnmGLLite::Vulkan
\ No newline at end of file
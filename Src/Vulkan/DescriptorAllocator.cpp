@@ -0,0 +1,132 @@
+#include "DnmGLLite/Vulkan/DescriptorAllocator.hpp"
+
+namespace DnmGLLite::Vulkan {
+    // default size of a pool, allocations bigger than it get their own pool
+    constexpr uint32_t pool_set_count = 128;
+    constexpr uint32_t pool_descriptor_count = 256;
+    constexpr vk::DescriptorType pool_descriptor_types[] = {
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eUniformBuffer,
+        vk::DescriptorType::eCombinedImageSampler,
+        vk::DescriptorType::eStorageImage,
+    };
+
+    DescriptorAllocator::DescriptorAllocator(Vulkan::Context& context)
+        : m_context(context) {}
+
+    DescriptorAllocator::~DescriptorAllocator() {
+        // sets freed with their pools
+        for (const auto& pool : m_pools) {
+            m_context.GetDevice().destroy(pool.pool);
+        }
+    }
+
+    DescriptorAllocation DescriptorAllocator::Allocate(
+        std::span<const vk::DescriptorSetLayout> layouts, std::span<const vk::DescriptorPoolSize> descriptor_counts) {
+        if (layouts.empty()) return {};
+
+        const auto device = m_context.GetDevice();
+        const uint32_t set_count = layouts.size();
+
+        DescriptorAllocation allocation{};
+        allocation.sets.resize(set_count);
+        allocation.descriptor_counts.assign(descriptor_counts.begin(), descriptor_counts.end());
+
+        const auto alloc_info = vk::DescriptorSetAllocateInfo{}.setSetLayouts(layouts);
+
+        const auto try_allocate = [&] (Pool& pool) {
+            auto info = alloc_info;
+            info.setDescriptorPool(pool.pool);
+            // no exception, out of pool memory and fragmented pool are expected here
+            const auto result = device.allocateDescriptorSets(&info, allocation.sets.data());
+            if (result != vk::Result::eSuccess) {
+                pool.fragmented = true;
+                return false;
+            }
+
+            pool.free_set_count -= set_count;
+            for (const auto& count : descriptor_counts) {
+                auto it = std::ranges::find(pool.free_descriptor_counts, count.type, &vk::DescriptorPoolSize::type);
+                it->descriptorCount -= count.descriptorCount;
+            }
+            return true;
+        };
+
+        for (uint32_t i{}; i < m_pools.size(); ++i) {
+            auto& pool = m_pools[i];
+            if (pool.fragmented || !Fits(pool, set_count, descriptor_counts)) continue;
+
+            if (try_allocate(pool)) {
+                allocation.pool_index = i;
+                return allocation;
+            }
+        }
+
+        auto& pool = CreatePool(set_count, descriptor_counts);
+        const bool allocated = try_allocate(pool);
+        DnmGLLiteAssert(allocated, "failed to allocate {} descriptor sets from a new pool", set_count)
+        allocation.pool_index = m_pools.size() - 1;
+        return allocation;
+    }
+
+    void DescriptorAllocator::Free(DescriptorAllocation&& allocation, const Context::RetireTicket& ticket) {
+        if (allocation.sets.empty()) return;
+        m_retired_allocations.emplace_back(std::move(allocation), ticket);
+    }
+
+    void DescriptorAllocator::Collect(const Context::RetireTicket& completed_ticket) {
+        const auto it = std::ranges::find_if(m_retired_allocations, [&completed_ticket] (const RetiredAllocation& retired) {
+            return !retired.ticket.IsCompleteAt(completed_ticket);
+        });
+
+        for (const auto& [allocation, _] : std::ranges::subrange(m_retired_allocations.begin(), it)) {
+            auto& pool = m_pools[allocation.pool_index];
+            m_context.GetDevice().freeDescriptorSets(pool.pool, allocation.sets);
+
+            pool.free_set_count += allocation.sets.size();
+            for (const auto& count : allocation.descriptor_counts) {
+                auto count_it = std::ranges::find(pool.free_descriptor_counts, count.type, &vk::DescriptorPoolSize::type);
+                count_it->descriptorCount += count.descriptorCount;
+            }
+            pool.fragmented = false;
+        }
+        m_retired_allocations.erase(m_retired_allocations.begin(), it);
+    }
+
+    bool DescriptorAllocator::Fits(const Pool& pool, uint32_t set_count, std::span<const vk::DescriptorPoolSize> descriptor_counts) {
+        if (pool.free_set_count < set_count) return false;
+
+        for (const auto& count : descriptor_counts) {
+            auto it = std::ranges::find(pool.free_descriptor_counts, count.type, &vk::DescriptorPoolSize::type);
+            if (it == pool.free_descriptor_counts.end() || it->descriptorCount < count.descriptorCount)
+                return false;
+        }
+        return true;
+    }
+
+    DescriptorAllocator::Pool& DescriptorAllocator::CreatePool(
+        uint32_t set_count, std::span<const vk::DescriptorPoolSize> descriptor_counts) {
+        auto& pool = m_pools.emplace_back();
+        pool.free_set_count = std::max(pool_set_count, set_count);
+
+        for (const auto type : pool_descriptor_types) {
+            pool.free_descriptor_counts.emplace_back(type, pool_descriptor_count);
+        }
+        for (const auto& count : descriptor_counts) {
+            auto it = std::ranges::find(pool.free_descriptor_counts, count.type, &vk::DescriptorPoolSize::type);
+            if (it == pool.free_descriptor_counts.end()) {
+                pool.free_descriptor_counts.emplace_back(count);
+            }
+            else {
+                it->descriptorCount = std::max(it->descriptorCount, count.descriptorCount);
+            }
+        }
+
+        pool.pool = m_context.GetDevice().createDescriptorPool(
+            vk::DescriptorPoolCreateInfo{}
+                .setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+                .setMaxSets(pool.free_set_count)
+                .setPoolSizes(pool.free_descriptor_counts));
+        return pool;
+    }
+}
\ No newline at end of file
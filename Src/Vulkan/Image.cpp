@@ -1,6 +1,9 @@
 #include "DnmGLLite/Vulkan/Image.hpp"
 #include "DnmGLLite/Vulkan/CommandBuffer.hpp"
+#include "DnmGLLite/Vulkan/BindlessTable.hpp"
+#include <vulkan/vulkan_format_traits.hpp>
 #include <vma/vk_mem_alloc.h>
+#include <numeric>
 #include <ranges>
 
 namespace DnmGLLite::Vulkan {
@@ -49,8 +52,45 @@ namespace DnmGLLite::Vulkan {
         return vk_flags;
     }
 
-    Image::Image(Vulkan::Context& ctx, const DnmGLLite::ImageDesc& desc)
-    : DnmGLLite::Image(ctx, desc) {
+    static vk::ImageCreateInfo GetVkImageCreateInfo(Vulkan::Context& ctx, const DnmGLLite::ImageDesc& desc) {
+        vk::ImageCreateFlags flags{};
+        if (desc.type == ImageType::e3D) flags |= vk::ImageCreateFlagBits::e2DArrayCompatible;
+        if (desc.type == ImageType::e2D && desc.extent.z >= 6) flags |= vk::ImageCreateFlagBits::eCubeCompatible;
+
+        vk::ImageCreateInfo create_info{};
+        create_info.setInitialLayout(vk::ImageLayout::ePreinitialized)
+                    .setImageType(GetVkImageType(desc.type))
+                    .setArrayLayers((desc.type == ImageType::e2D) ? desc.extent.z : 1u)
+                    .setExtent(vk::Extent3D(desc.extent.x, desc.extent.y, (desc.type == ImageType::e3D) ? 1 : desc.extent.z))
+                    .setFlags(flags)
+                    .setSamples(static_cast<vk::SampleCountFlagBits>(desc.sample_count))
+                    .setSharingMode(vk::SharingMode::eExclusive)
+                    .setTiling(vk::ImageTiling::eOptimal)
+                    .setUsage(GetVkImageUsageFlags(desc.usage_flags))
+                    .setFormat(static_cast<vk::Format>(desc.format))
+                    .setMipLevels(desc.mipmap_levels)
+                    ;
+
+        // compute queue can write it without ownership transfers
+        const auto concurrent_families = ctx.GetConcurrentQueueFamilies();
+        if (desc.usage_flags.Has(ImageUsageBits::eStorage) && !concurrent_families.empty()) {
+            create_info.setSharingMode(vk::SharingMode::eConcurrent)
+                       .setQueueFamilyIndices(concurrent_families);
+        }
+        return create_info;
+    }
+
+    vk::MemoryRequirements Image::GetMemoryRequirements(Vulkan::Context& ctx, const DnmGLLite::ImageDesc& desc) {
+        const auto device = ctx.GetDevice();
+        // temporary image, device image memory requirements query needs vulkan 1.3
+        const auto image = device.createImage(GetVkImageCreateInfo(ctx, desc));
+        const auto requirements = device.getImageMemoryRequirements(image);
+        device.destroy(image);
+        return requirements;
+    }
+
+    Image::Image(Vulkan::Context& ctx, const DnmGLLite::ImageDesc& desc, std::shared_ptr<VmaAllocation_T> aliased_allocation)
+    : DnmGLLite::Image(ctx, desc), m_aliased_allocation(std::move(aliased_allocation)) {
         DnmGLLiteAssert(m_desc.mipmap_levels != 0, "mipmap level cannot be 0")
         DnmGLLiteAssert(m_desc.extent.x != 0 || m_desc.extent.y != 0 || m_desc.extent.z != 0, "extent values cannot be 0")
         if (m_desc.type == ImageType::e1D) {
@@ -70,36 +110,33 @@ namespace DnmGLLite::Vulkan {
             }
         }
 
-        vk::ImageCreateFlags flags{};
-        if (m_desc.type == ImageType::e3D) flags |= vk::ImageCreateFlagBits::e2DArrayCompatible;
-        if (m_desc.type == ImageType::e2D && m_desc.extent.z >= 6) flags |= vk::ImageCreateFlagBits::eCubeCompatible;
+        m_subresource_layouts.assign(m_desc.mipmap_levels * GetLayerCount(), vk::ImageLayout::ePreinitialized);
 
-        vk::ImageCreateInfo create_info{};
-        create_info.setInitialLayout(vk::ImageLayout::ePreinitialized)
-                    .setImageType(GetVkImageType(m_desc.type))
-                    .setArrayLayers((m_desc.type == ImageType::e2D) ? m_desc.extent.z : 1u)
-                    .setExtent(vk::Extent3D(m_desc.extent.x, m_desc.extent.y, (m_desc.type == ImageType::e3D) ? 1 : m_desc.extent.z))
-                    .setFlags(flags)
-                    .setSamples(static_cast<vk::SampleCountFlagBits>(desc.sample_count))
-                    .setSharingMode(vk::SharingMode::eExclusive)
-                    .setTiling(vk::ImageTiling::eOptimal)
-                    .setUsage(GetVkImageUsageFlags(m_desc.usage_flags))
-                    .setFormat(static_cast<vk::Format>(m_desc.format))
-                    .setMipLevels(m_desc.mipmap_levels)
-                    ;
+        const auto create_info = GetVkImageCreateInfo(ctx, m_desc);
+        m_sharing_mode = create_info.sharingMode;
 
-        VmaAllocationCreateInfo alloc_create_info{};
-        alloc_create_info.usage = VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO;
-        alloc_create_info.priority = 1.f;
+        vk::Result result;
+        if (m_aliased_allocation) {
+            result = (vk::Result)vmaCreateAliasingImage(
+                VulkanContext->GetVmaAllocator(), 
+                m_aliased_allocation.get(), 
+                reinterpret_cast<const VkImageCreateInfo*>(&create_info), 
+                reinterpret_cast<VkImage*>(&m_image));
+        }
+        else {
+            VmaAllocationCreateInfo alloc_create_info{};
+            alloc_create_info.usage = VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO;
+            alloc_create_info.priority = 1.f;
 
-        VmaAllocationInfo alloc_info;
-        auto result = (vk::Result)vmaCreateImage(
-            VulkanContext->GetVmaAllocator(), 
-            reinterpret_cast<VkImageCreateInfo*>(&create_info), 
-            &alloc_create_info, 
-            reinterpret_cast<VkImage*>(&m_image), 
-            &m_allocation, 
-            &alloc_info);
+            VmaAllocationInfo alloc_info;
+            result = (vk::Result)vmaCreateImage(
+                VulkanContext->GetVmaAllocator(), 
+                reinterpret_cast<const VkImageCreateInfo*>(&create_info), 
+                &alloc_create_info, 
+                reinterpret_cast<VkImage*>(&m_image), 
+                &m_allocation, 
+                &alloc_info);
+        }
 
         if (result == vk::Result::eErrorOutOfDeviceMemory || result == vk::Result::eErrorOutOfHostMemory) {
             VulkanContext->Message("vmaCreateImage create buffer failed, out of memory", MessageType::eOutOfMemory);
@@ -129,21 +166,108 @@ namespace DnmGLLite::Vulkan {
                 m_aspect,
                 Image::GetIdealImageLayout()
             });
-            m_image_layout = Image::GetIdealImageLayout();
+            SetImageLayout(Image::GetIdealImageLayout());
+        }
+
+        // views can't have both depth and stencil aspects in shaders
+        const bool sampled = m_desc.usage_flags.Has(ImageUsageBits::eSampled);
+        const bool storage = m_desc.usage_flags.Has(ImageUsageBits::eStorage);
+        auto* bindless_table = VulkanContext->GetBindlessTable();
+        if (bindless_table && (sampled || storage) 
+            && m_aspect != (vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil)) {
+            ImageSubresource subresource{
+                .type = ImageResourceType::e2D,
+                .layer_count = 1,
+                .mipmap_level = m_desc.mipmap_levels,
+            };
+            if (m_desc.type == ImageType::e1D) subresource.type = ImageResourceType::e1D;
+            else if (m_desc.type == ImageType::e3D) subresource.type = ImageResourceType::e3D;
+            else if (m_desc.extent.z > 1) {
+                subresource.type = ImageResourceType::e2DArray;
+                subresource.layer_count = m_desc.extent.z;
+            }
+
+            m_bindless_index = bindless_table->AddImage(CreateGetImageView(subresource), Image::GetIdealImageLayout(), sampled, storage);
         }
     }
 
     Image::~Image() {
-        const auto image = m_image;
-        const auto image_views = std::move(m_image_views);
-        auto* allocation = m_allocation;
-        VulkanContext->DeleteObject(
-            [image, allocation, image_views] (vk::Device device, VmaAllocator allocator) -> void {
-            for (auto image_view : image_views | std::ranges::views::values)
-                device.destroy(image_view);
-
-            vmaDestroyImage(allocator, image, allocation);
-        });
+        if (auto* bindless_table = VulkanContext->GetBindlessTable()) {
+            bindless_table->Remove(BindlessArray::eImage, m_bindless_index, VulkanContext->GetRetireTicket());
+        }
+        for (const auto image_view : m_image_views | std::ranges::views::values)
+            VulkanContext->DeleteObject(image_view);
+
+        // aliased memory released by m_aliased_allocation after this, so it's retired after the image
+        VulkanContext->DeleteObject(m_image, m_allocation);
+    }
+
+    bool Image::HasImageLayout(const vk::ImageSubresourceRange& range, vk::ImageLayout layout) const {
+        const uint32_t mipmap_count = range.levelCount == VK_REMAINING_MIP_LEVELS ? m_desc.mipmap_levels - range.baseMipLevel : range.levelCount;
+        const uint32_t layer_count = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? GetLayerCount() - range.baseArrayLayer : range.layerCount;
+
+        for (uint32_t mipmap = range.baseMipLevel; mipmap < range.baseMipLevel + mipmap_count; ++mipmap) {
+            for (uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + layer_count; ++layer) {
+                if (GetImageLayout(mipmap, layer) != layout) return false;
+            }
+        }
+        return true;
+    }
+
+    void Image::AddLayoutBarriers(std::vector<vk::ImageMemoryBarrier>& barriers, const vk::ImageSubresourceRange& range, 
+        vk::ImageLayout new_layout, vk::AccessFlags src_access, vk::AccessFlags dst_access) {
+        const uint32_t mipmap_count = range.levelCount == VK_REMAINING_MIP_LEVELS ? m_desc.mipmap_levels - range.baseMipLevel : range.levelCount;
+        const uint32_t layer_count = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? GetLayerCount() - range.baseArrayLayer : range.layerCount;
+
+        const uint32_t first_barrier = barriers.size();
+
+        for (uint32_t mipmap = range.baseMipLevel; mipmap < range.baseMipLevel + mipmap_count; ++mipmap) {
+            const uint32_t level_begin = barriers.size();
+
+            uint32_t run_begin = range.baseArrayLayer;
+            while (run_begin < range.baseArrayLayer + layer_count) {
+                const auto old_layout = GetImageLayout(mipmap, run_begin);
+                uint32_t run_end = run_begin + 1;
+                while (run_end < range.baseArrayLayer + layer_count && GetImageLayout(mipmap, run_end) == old_layout) ++run_end;
+
+                // barrier ending at the previous mipmap level with the same layers is extended
+                const auto it = std::find_if(barriers.begin() + first_barrier, barriers.begin() + level_begin, 
+                    [&] (const vk::ImageMemoryBarrier& barrier) {
+                        return barrier.oldLayout == old_layout
+                            && barrier.subresourceRange.baseArrayLayer == run_begin
+                            && barrier.subresourceRange.layerCount == run_end - run_begin
+                            && barrier.subresourceRange.baseMipLevel + barrier.subresourceRange.levelCount == mipmap;
+                    });
+
+                if (it != barriers.begin() + level_begin) {
+                    ++it->subresourceRange.levelCount;
+                }
+                else {
+                    barriers.emplace_back(
+                        src_access,
+                        dst_access,
+                        old_layout,
+                        new_layout == vk::ImageLayout::eUndefined ? old_layout : new_layout,
+                        VK_QUEUE_FAMILY_IGNORED,
+                        VK_QUEUE_FAMILY_IGNORED,
+                        m_image,
+                        vk::ImageSubresourceRange(m_aspect, mipmap, 1, run_begin, run_end - run_begin));
+                }
+                run_begin = run_end;
+            }
+        }
+
+        if (new_layout == vk::ImageLayout::eUndefined) return;
+        for (uint32_t mipmap = range.baseMipLevel; mipmap < range.baseMipLevel + mipmap_count; ++mipmap) {
+            for (uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + layer_count; ++layer) {
+                m_subresource_layouts[mipmap * GetLayerCount() + layer] = new_layout;
+            }
+        }
+    }
+
+    uint32_t Image::GetCopyAlignment() const {
+        // Format values are the vulkan ones, depth stencil copies take one aspect at multiples of 4
+        return std::lcm<uint32_t>(vk::blockSize(static_cast<vk::Format>(m_desc.format)), 4);
     }
 
     vk::ImageView Image::CreateGetImageView(const ImageSubresource& subresource) {
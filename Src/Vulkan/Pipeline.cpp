@@ -51,7 +51,24 @@ namespace DnmGLLite::Vulkan {
             || (format == Format::eD16NormS8UInt);
     }
 
-    GraphicsPipeline::GraphicsPipeline(Vulkan::Context& ctx, const DnmGLLite::GraphicsPipelineDesc& desc) noexcept
+    // entries of the constants the shader declares, values packed in entry order
+    struct Specialization {
+        std::vector<vk::SpecializationMapEntry> entries{};
+        std::vector<uint32_t> values{};
+        vk::SpecializationInfo info{};
+    };
+
+    static void FillSpecialization(Specialization& specialization, const Vulkan::Shader* shader, const SpecializationConstants& constants) {
+        for (const auto& [id, value] : constants) {
+            if (!shader->HasSpecializationConstant(id)) continue;
+            specialization.entries.emplace_back(id, specialization.values.size() * sizeof(uint32_t), sizeof(uint32_t));
+            specialization.values.emplace_back(value);
+        }
+        specialization.info.setMapEntries(specialization.entries)
+                            .setData<uint32_t>(specialization.values);
+    }
+
+    GraphicsPipeline::GraphicsPipeline(Vulkan::Context& ctx, const DnmGLLite::GraphicsPipelineDesc& desc, bool async) noexcept
         : DnmGLLite::GraphicsPipeline(ctx, desc) {
 
         DnmGLLiteAssert(m_desc.resource_manager, "resource manager can not be null")
@@ -69,6 +86,13 @@ namespace DnmGLLite::Vulkan {
             DnmGLLiteAssert(fragment_shader_is_there, "fragment shader must be in resource manager")
         }
 
+        for (const auto id : m_desc.specialization_constants | std::views::keys) {
+            DnmGLLiteAssert(
+                static_cast<const Vulkan::Shader *>(m_desc.vertex_shader)->HasSpecializationConstant(id)
+                || static_cast<const Vulkan::Shader *>(m_desc.fragment_shader)->HasSpecializationConstant(id),
+                "specialization constant {} isn't declared by the vertex or fragment shader", id)
+        }
+
         if (IsDepthFormat(m_desc.depth_format)) {
             m_has_depth_attachment = true;
         }
@@ -80,18 +104,17 @@ namespace DnmGLLite::Vulkan {
             m_has_stencil_attachment = true;
         }
 
-        CreateRenderpass();
+        for (const auto i : Counter(GetColorAttachmentCount())) {
+            m_color_formats.emplace_back(m_desc.presenting ? VulkanContext->GetSwapchainProperties().format : ToVk(m_desc.color_attachment_formats[i]));
+        }
+
+        if (!VulkanContext->GetSupportedFeatures().dynamic_rendering) {
+            CreateRenderpass();
+        }
 
         const auto *typed_vertex_shader = static_cast<const Vulkan::Shader *>(m_desc.vertex_shader);
         const auto *typed_fragment_shader = static_cast<const Vulkan::Shader *>(m_desc.fragment_shader);
 
-        {
-            m_buffer_resource_access_info |= typed_vertex_shader->GetBufferResourceAccessInfo();
-            m_buffer_resource_access_info |= typed_fragment_shader->GetBufferResourceAccessInfo();
-            m_image_resource_access_info |= typed_vertex_shader->GetImageResourceAccessInfo();
-            m_image_resource_access_info |= typed_fragment_shader->GetImageResourceAccessInfo();
-        }
-
         const auto *typed_resource_manager = static_cast<const Vulkan::ResourceManager *>(m_desc.resource_manager);
         const auto device = VulkanContext->GetDevice();
 
@@ -125,9 +148,21 @@ namespace DnmGLLite::Vulkan {
                         ;
 
             m_pipeline_layout = device.createPipelineLayout(create_info);
+            m_set_layouts = std::move(dst_set_layouts);
+            m_push_constant_ranges = std::move(push_constants);
         }
 
-        const auto swapchain_properties = VulkanContext->GetSwapchainProperties();
+        if (async) {
+            m_ready.store(false, std::memory_order_relaxed);
+            return;
+        }
+        Compile();
+    }
+
+    void GraphicsPipeline::Compile() noexcept {
+        const auto *typed_vertex_shader = static_cast<const Vulkan::Shader *>(m_desc.vertex_shader);
+        const auto *typed_fragment_shader = static_cast<const Vulkan::Shader *>(m_desc.fragment_shader);
+        const auto device = VulkanContext->GetDevice();
 
         std::vector<vk::VertexInputAttributeDescription> vertex_attrib_desc{};
         vk::VertexInputBindingDescription vertex_binding_desc{};
@@ -135,7 +170,7 @@ namespace DnmGLLite::Vulkan {
         {
             uint32_t location{};
             uint32_t offset{};
-            for (const auto& binding_format : desc.vertex_binding_formats) {
+            for (const auto& binding_format : m_desc.vertex_binding_formats) {
                 const auto size = GetFormatSize(binding_format);
                 DnmGLLiteAssert(size, "unsupported vertex binding format; location: {}", location)
                 vertex_attrib_desc.emplace_back(
@@ -173,6 +208,13 @@ namespace DnmGLLite::Vulkan {
                                     .setPName("main")
                                     ;
 
+        Specialization specializations[2]{};
+        FillSpecialization(specializations[0], typed_vertex_shader, m_desc.specialization_constants);
+        FillSpecialization(specializations[1], typed_fragment_shader, m_desc.specialization_constants);
+        for (const auto i : Counter(2)) {
+            shader_stage_create_info[i].setPSpecializationInfo(specializations[i].entries.empty() ? nullptr : &specializations[i].info);
+        }
+
         vk::PipelineViewportStateCreateInfo viewport_state_create_info{};
         viewport_state_create_info
             .setScissorCount(1).setViewportCount(1);
@@ -224,8 +266,14 @@ namespace DnmGLLite::Vulkan {
         vk::PipelineDynamicStateCreateInfo dynamic_state_create_info{};
         dynamic_state_create_info.setDynamicStates(dynamic_states);
 
+        const auto rendering_info = vk::PipelineRenderingCreateInfoKHR{}
+            .setColorAttachmentFormats(m_color_formats)
+            .setDepthAttachmentFormat(GetDepthFormat())
+            .setStencilAttachmentFormat(GetStencilFormat());
+
         vk::GraphicsPipelineCreateInfo pipeline_info{};
-        pipeline_info.setLayout(m_pipeline_layout)
+        pipeline_info.setPNext(VulkanContext->GetSupportedFeatures().dynamic_rendering ? &rendering_info : nullptr)
+                    .setLayout(m_pipeline_layout)
                     .setStages(shader_stage_create_info)
                     .setPViewportState(&viewport_state_create_info)
                     .setPRasterizationState(&rester_info)
@@ -239,7 +287,10 @@ namespace DnmGLLite::Vulkan {
                     .setSubpass(0)
                     ;
 
-        m_pipeline = device.createGraphicsPipeline(nullptr, pipeline_info).value;
+        m_pipeline = device.createGraphicsPipeline(VulkanContext->GetPipelineCache(), pipeline_info).value;
+
+        m_ready.store(true, std::memory_order_release);
+        m_ready.notify_all();
     }
 
     void GraphicsPipeline::CreateRenderpass() noexcept {
@@ -259,7 +310,7 @@ namespace DnmGLLite::Vulkan {
                 vk::AttachmentLoadOp::eDontCare,
                 vk::AttachmentStoreOp::eDontCare,
                 vk::ImageLayout::eUndefined,
-                m_desc.presenting ? vk::ImageLayout::ePresentSrcKHR : vk::ImageLayout::eColorAttachmentOptimal
+                m_desc.presenting ? VulkanContext->GetPresentImageLayout() : vk::ImageLayout::eColorAttachmentOptimal
             );
 
             if (HasMsaa()) {
@@ -430,6 +481,12 @@ namespace DnmGLLite::Vulkan {
             }
         }
 
+        // views are passed to BeginRendering instead
+        if (VulkanContext->GetSupportedFeatures().dynamic_rendering) {
+            m_attachment_views = std::move(image_views);
+            return;
+        }
+
         vk::FramebufferCreateInfo framebuffer_info{};
         framebuffer_info.setAttachments(image_views)
                         .setWidth(extent.x)
@@ -470,7 +527,7 @@ namespace DnmGLLite::Vulkan {
         });
     }
 
-    ComputePipeline::ComputePipeline(Vulkan::Context& ctx, const DnmGLLite::ComputePipelineDesc& desc) noexcept
+    ComputePipeline::ComputePipeline(Vulkan::Context& ctx, const DnmGLLite::ComputePipelineDesc& desc, bool async) noexcept
         : DnmGLLite::ComputePipeline(ctx, desc) {
 
         DnmGLLiteAssert(m_desc.resource_manager, "resource manager can not be null")
@@ -484,13 +541,13 @@ namespace DnmGLLite::Vulkan {
             DnmGLLiteAssert(shader_is_there, "shader must be in resource manager")
         }
 
-        const auto *typed_shader = static_cast<const Vulkan::Shader *>(m_desc.shader);
-
-        {
-            m_buffer_resource_access_info |= typed_shader->GetBufferResourceAccessInfo();
-            m_image_resource_access_info |= typed_shader->GetImageResourceAccessInfo();
+        for (const auto id : m_desc.specialization_constants | std::views::keys) {
+            DnmGLLiteAssert(static_cast<const Vulkan::Shader *>(m_desc.shader)->HasSpecializationConstant(id),
+                "specialization constant {} isn't declared by the compute shader", id)
         }
 
+        const auto *typed_shader = static_cast<const Vulkan::Shader *>(m_desc.shader);
+
         const auto *typed_resource_manager = static_cast<const Vulkan::ResourceManager *>(m_desc.resource_manager);
         const auto device = VulkanContext->GetDevice();
 
@@ -514,12 +571,30 @@ namespace DnmGLLite::Vulkan {
                         )
                         .setPushConstantRangeCount(typed_shader->GetPushConstants().has_value());
             m_pipeline_layout = device.createPipelineLayout(create_info);
+            m_set_layouts = std::move(dst_set_layouts);
+            if (typed_shader->GetPushConstants().has_value()) {
+                m_push_constant_ranges.emplace_back(push_constant);
+            }
         }
 
+        if (async) {
+            m_ready.store(false, std::memory_order_relaxed);
+            return;
+        }
+        Compile();
+    }
+
+    void ComputePipeline::Compile() noexcept {
+        const auto *typed_shader = static_cast<const Vulkan::Shader *>(m_desc.shader);
+
+        Specialization specialization{};
+        FillSpecialization(specialization, typed_shader, m_desc.specialization_constants);
+
         vk::PipelineShaderStageCreateInfo stage_info{};
         stage_info.setStage(vk::ShaderStageFlagBits::eCompute)
                     .setModule(typed_shader->GetShaderModule())
-                    .setPName("name")
+                    .setPName("main")
+                    .setPSpecializationInfo(specialization.entries.empty() ? nullptr : &specialization.info)
                     ;
 
         vk::ComputePipelineCreateInfo pipeline_info{};
@@ -528,6 +603,9 @@ namespace DnmGLLite::Vulkan {
                     .setLayout(m_pipeline_layout)
                     ;
 
-        m_pipeline = device.createComputePipeline(nullptr, pipeline_info).value;
+        m_pipeline = VulkanContext->GetDevice().createComputePipeline(VulkanContext->GetPipelineCache(), pipeline_info).value;
+
+        m_ready.store(true, std::memory_order_release);
+        m_ready.notify_all();
     }
 }
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "DnmGLLite/Vulkan/PipelineCache.hpp"
+#include "DnmGLLite/Vulkan/Shader.hpp"
+#include "DnmGLLite/Vulkan/ResourceManager.hpp"
+#include "DnmGLLite/Vulkan/Pipeline.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <latch>
+#include <map>
+#include <sstream>
+
+namespace DnmGLLite::Vulkan {
+    // written before the driver data, file ignored if any field differs from the current device
+    struct PipelineCacheFileHeader {
+        uint32_t magic;
+        uint32_t data_size;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t uuid[VK_UUID_SIZE];
+    };
+
+    static constexpr uint32_t pipeline_cache_magic = 0x43474C44; // "DLGC"
+    // more than any desc has, entry is broken
+    static constexpr uint32_t max_manifest_count = 256;
+
+    static PipelineCacheFileHeader GetDeviceCacheHeader(vk::PhysicalDevice physical_device) {
+        const auto properties = physical_device.getProperties();
+
+        PipelineCacheFileHeader header{
+            .magic = pipeline_cache_magic,
+            .data_size = 0,
+            .vendor_id = properties.vendorID,
+            .device_id = properties.deviceID,
+            .driver_version = properties.driverVersion,
+        };
+        std::memcpy(header.uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+        return header;
+    }
+
+    // manifest entries are one line of space separated values, enums written as integers
+    template <typename T>
+    static void WriteValue(std::ostream& stream, T value) {
+        stream << ' ' << static_cast<uint32_t>(value);
+    }
+
+    template <typename T>
+    static void WriteValues(std::ostream& stream, const std::vector<T>& values) {
+        WriteValue(stream, values.size());
+        for (const auto value : values) {
+            WriteValue(stream, value);
+        }
+    }
+
+    template <typename T>
+    static T ReadValue(std::istream& stream) {
+        uint32_t value{};
+        stream >> value;
+        return static_cast<T>(value);
+    }
+
+    template <typename T>
+    static std::vector<T> ReadValues(std::istream& stream) {
+        const auto count = ReadValue<uint32_t>(stream);
+        if (!stream || count > max_manifest_count) {
+            stream.setstate(std::ios::failbit);
+            return {};
+        }
+
+        std::vector<T> values(count);
+        for (auto& value : values) {
+            value = ReadValue<T>(stream);
+        }
+        return values;
+    }
+
+    // count, then id and value of each constant
+    static void WriteSpecializationConstants(std::ostream& stream, const SpecializationConstants& constants) {
+        WriteValue(stream, constants.size());
+        for (const auto& [id, value] : constants) {
+            WriteValue(stream, id);
+            WriteValue(stream, value);
+        }
+    }
+
+    static SpecializationConstants ReadSpecializationConstants(std::istream& stream) {
+        const auto count = ReadValue<uint32_t>(stream);
+        if (!stream || count > max_manifest_count) {
+            stream.setstate(std::ios::failbit);
+            return {};
+        }
+
+        SpecializationConstants constants{};
+        for ([[maybe_unused]] const auto i : Counter(count)) {
+            const auto id = ReadValue<uint32_t>(stream);
+            constants[id] = ReadValue<uint32_t>(stream);
+        }
+        return constants;
+    }
+
+    // shaders of the resource manager by absolute path, then index of each stage shader in them
+    static void WriteShaders(std::ostream& stream, const DnmGLLite::ResourceManager* resource_manager, std::span<const DnmGLLite::Shader* const> stage_shaders) {
+        const auto& shaders = resource_manager->GetShaders();
+
+        WriteValue(stream, shaders.size());
+        for (const auto* shader : shaders) {
+            stream << ' ' << std::quoted(std::filesystem::absolute(shader->GetPath()).string());
+        }
+        for (const auto* stage_shader : stage_shaders) {
+            WriteValue(stream, std::distance(shaders.begin(), std::ranges::find(shaders, stage_shader)));
+        }
+    }
+
+    PipelineCache::PipelineCache(Vulkan::Context& context, const std::filesystem::path& path)
+        : m_context(context),
+        m_path(path) {
+        const auto data = LoadCacheData();
+
+        m_pipeline_cache = m_context.GetDevice().createPipelineCache(
+            vk::PipelineCacheCreateInfo{}
+                .setInitialDataSize(data.size())
+                .setPInitialData(data.data()));
+
+        if (!m_path.empty()) {
+            LoadManifest();
+        }
+    }
+
+    PipelineCache::~PipelineCache() {
+        // pending compiles finish before the cache is saved
+        m_workers.clear();
+        Save();
+        m_context.GetDevice().destroy(m_pipeline_cache);
+    }
+
+    std::vector<uint8_t> PipelineCache::LoadCacheData() const {
+        if (m_path.empty()) return {};
+
+        std::ifstream file(m_path, std::ios::binary);
+        if (!file) return {};
+
+        PipelineCacheFileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file) return {};
+
+        const auto device_header = GetDeviceCacheHeader(m_context.GetPhysicalDevice());
+        if (header.magic != device_header.magic
+            || header.vendor_id != device_header.vendor_id
+            || header.device_id != device_header.device_id
+            || header.driver_version != device_header.driver_version
+            || std::memcmp(header.uuid, device_header.uuid, VK_UUID_SIZE) != 0) {
+            m_context.Message("pipeline cache saved by another device or driver, ignored", MessageType::eInfo);
+            return {};
+        }
+
+        std::vector<uint8_t> data(header.data_size);
+        file.read(reinterpret_cast<char*>(data.data()), data.size());
+        if (static_cast<size_t>(file.gcount()) != data.size()) return {};
+
+        return data;
+    }
+
+    void PipelineCache::LoadManifest() {
+        std::ifstream file(GetManifestPath());
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) m_warm_up_entries.emplace_back(std::move(line));
+        }
+    }
+
+    void PipelineCache::Save() {
+        if (m_path.empty()) return;
+
+        const auto data = m_context.GetDevice().getPipelineCacheData(m_pipeline_cache);
+
+        auto header = GetDeviceCacheHeader(m_context.GetPhysicalDevice());
+        header.data_size = static_cast<uint32_t>(data.size());
+
+        // renamed after writing, an interrupted save never leaves a broken file
+        const std::filesystem::path temp_path = m_path.string() + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+            if (!file) {
+                m_context.Message(std::format("failed to write pipeline cache, {}", temp_path.string()), MessageType::eInvalidBehavior);
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temp_path, m_path, error);
+        if (error) {
+            m_context.Message(std::format("failed to write pipeline cache, {}", error.message()), MessageType::eInvalidBehavior);
+            return;
+        }
+
+        std::ofstream manifest(GetManifestPath(), std::ios::trunc);
+        std::scoped_lock lock(m_manifest_mutex);
+        for (const auto& entry : m_manifest) {
+            manifest << entry << '\n';
+        }
+    }
+
+    void PipelineCache::Record(const DnmGLLite::GraphicsPipelineDesc& desc) {
+        std::ostringstream stream;
+        stream << "graphics";
+
+        const DnmGLLite::Shader* stage_shaders[] = {desc.vertex_shader, desc.fragment_shader};
+        WriteShaders(stream, desc.resource_manager, stage_shaders);
+
+        WriteValues(stream, desc.color_attachment_formats);
+        WriteValues(stream, desc.vertex_binding_formats);
+        WriteValues(stream, desc.color_load_op);
+        WriteValues(stream, desc.color_store_op);
+        WriteValue(stream, desc.depth_format);
+        WriteValue(stream, desc.stencil_format);
+        WriteValue(stream, desc.depth_load_op);
+        WriteValue(stream, desc.depth_store_op);
+        WriteValue(stream, desc.stencil_load_op);
+        WriteValue(stream, desc.stencil_store_op);
+        WriteValue(stream, desc.depth_test_compare_op);
+        WriteValue(stream, desc.polygone_mode);
+        WriteValue(stream, desc.cull_mode);
+        WriteValue(stream, desc.front_face);
+        WriteValue(stream, desc.topology);
+        WriteValue(stream, desc.msaa);
+        WriteValue(stream, bool(desc.depth_test));
+        WriteValue(stream, bool(desc.depth_write));
+        WriteValue(stream, bool(desc.stencil_test));
+        WriteValue(stream, bool(desc.presenting));
+        WriteValue(stream, bool(desc.color_blend));
+        WriteSpecializationConstants(stream, desc.specialization_constants);
+
+        std::scoped_lock lock(m_manifest_mutex);
+        m_manifest.emplace(stream.str());
+    }
+
+    void PipelineCache::Record(const DnmGLLite::ComputePipelineDesc& desc) {
+        std::ostringstream stream;
+        stream << "compute";
+
+        const DnmGLLite::Shader* stage_shaders[] = {desc.shader};
+        WriteShaders(stream, desc.resource_manager, stage_shaders);
+        WriteSpecializationConstants(stream, desc.specialization_constants);
+
+        std::scoped_lock lock(m_manifest_mutex);
+        m_manifest.emplace(stream.str());
+    }
+
+    void PipelineCache::WarmUp() {
+        if (m_warm_up_entries.empty()) return;
+
+        struct WarmUpPipeline {
+            std::unique_ptr<Vulkan::ResourceManager> resource_manager;
+            std::variant<DnmGLLite::GraphicsPipelineDesc, DnmGLLite::ComputePipelineDesc> desc;
+            std::unique_ptr<DnmGLLite::GraphicsPipeline> graphics_pipeline{};
+            std::unique_ptr<DnmGLLite::ComputePipeline> compute_pipeline{};
+        };
+
+        // shared by entries, shaders and resource managers created on this thread
+        std::map<std::string, std::unique_ptr<Vulkan::Shader>> shaders{};
+        std::vector<WarmUpPipeline> pipelines{};
+
+        // nullptr if a shader was moved or deleted since the last run
+        const auto read_resource_manager = [this, &shaders] (std::istream& stream, std::span<DnmGLLite::Shader*> stage_shaders)
+            -> std::unique_ptr<Vulkan::ResourceManager> {
+            const auto count = ReadValue<uint32_t>(stream);
+            if (!stream || count == 0 || count > max_manifest_count) return nullptr;
+
+            std::vector<DnmGLLite::Shader*> manager_shaders(count);
+            for (auto& shader : manager_shaders) {
+                std::string path;
+                stream >> std::quoted(path);
+                if (!stream || !std::filesystem::exists(path)) return nullptr;
+
+                auto& cached_shader = shaders[path];
+                if (!cached_shader) cached_shader = std::make_unique<Vulkan::Shader>(m_context, path);
+                shader = cached_shader.get();
+            }
+
+            for (auto& stage_shader : stage_shaders) {
+                const auto index = ReadValue<uint32_t>(stream);
+                if (!stream || index >= manager_shaders.size()) return nullptr;
+                stage_shader = manager_shaders[index];
+            }
+
+            std::vector<const DnmGLLite::Shader*> const_shaders(manager_shaders.begin(), manager_shaders.end());
+            return std::make_unique<Vulkan::ResourceManager>(m_context, const_shaders, false);
+        };
+
+        // shader may have changed since the last run, pipelines assert on undeclared constants
+        const auto constants_declared = [] (const SpecializationConstants& constants, std::span<DnmGLLite::Shader* const> stage_shaders) {
+            return std::ranges::all_of(constants | std::views::keys, [stage_shaders] (uint32_t id) {
+                return std::ranges::any_of(stage_shaders, [id] (const DnmGLLite::Shader* shader) {
+                    return static_cast<const Vulkan::Shader*>(shader)->HasSpecializationConstant(id);
+                });
+            });
+        };
+
+        for (const auto& entry : m_warm_up_entries) {
+            std::istringstream stream(entry);
+            std::string type;
+            stream >> type;
+
+            if (type == "graphics") {
+                DnmGLLite::Shader* stage_shaders[2]{};
+                auto resource_manager = read_resource_manager(stream, stage_shaders);
+                if (!resource_manager) continue;
+
+                DnmGLLite::GraphicsPipelineDesc desc{};
+                desc.vertex_shader = stage_shaders[0];
+                desc.fragment_shader = stage_shaders[1];
+                desc.resource_manager = resource_manager.get();
+                desc.color_attachment_formats = ReadValues<Format>(stream);
+                desc.vertex_binding_formats = ReadValues<Format>(stream);
+                desc.color_load_op = ReadValues<AttachmentLoadOp>(stream);
+                desc.color_store_op = ReadValues<AttachmentStoreOp>(stream);
+                desc.depth_format = ReadValue<Format>(stream);
+                desc.stencil_format = ReadValue<Format>(stream);
+                desc.depth_load_op = ReadValue<AttachmentLoadOp>(stream);
+                desc.depth_store_op = ReadValue<AttachmentStoreOp>(stream);
+                desc.stencil_load_op = ReadValue<AttachmentLoadOp>(stream);
+                desc.stencil_store_op = ReadValue<AttachmentStoreOp>(stream);
+                desc.depth_test_compare_op = ReadValue<CompareOp>(stream);
+                desc.polygone_mode = ReadValue<PolygonMode>(stream);
+                desc.cull_mode = ReadValue<CullMode>(stream);
+                desc.front_face = ReadValue<FrontFace>(stream);
+                desc.topology = ReadValue<PrimitiveTopology>(stream);
+                desc.msaa = ReadValue<SampleCount>(stream);
+                desc.depth_test = ReadValue<bool>(stream);
+                desc.depth_write = ReadValue<bool>(stream);
+                desc.stencil_test = ReadValue<bool>(stream);
+                desc.presenting = ReadValue<bool>(stream);
+                desc.color_blend = ReadValue<bool>(stream);
+                desc.specialization_constants = ReadSpecializationConstants(stream);
+                if (!stream) continue;
+
+                // color ops are indexed by attachment in the pipeline
+                const auto color_count = desc.presenting ? 1 : desc.color_attachment_formats.size();
+                if (desc.color_load_op.size() < color_count || desc.color_store_op.size() < color_count) continue;
+                if (!constants_declared(desc.specialization_constants, stage_shaders)) continue;
+
+                pipelines.emplace_back(std::move(resource_manager), desc);
+            }
+            else if (type == "compute") {
+                DnmGLLite::Shader* stage_shaders[1]{};
+                auto resource_manager = read_resource_manager(stream, stage_shaders);
+                if (!resource_manager) continue;
+
+                const DnmGLLite::ComputePipelineDesc desc{
+                    .shader = stage_shaders[0],
+                    .resource_manager = resource_manager.get(),
+                    .specialization_constants = ReadSpecializationConstants(stream),
+                };
+                if (!stream || !constants_declared(desc.specialization_constants, stage_shaders)) continue;
+
+                pipelines.emplace_back(std::move(resource_manager), desc);
+            }
+        }
+        m_warm_up_entries.clear();
+
+        if (pipelines.empty()) return;
+
+        // pipeline constructors only create device objects, vkCreate*Pipelines and the cache are thread safe
+        std::latch compiled(pipelines.size());
+        for (auto& pipeline : pipelines) {
+            Submit([this, &pipeline, &compiled] {
+                if (const auto* desc = std::get_if<DnmGLLite::GraphicsPipelineDesc>(&pipeline.desc)) {
+                    pipeline.graphics_pipeline = std::make_unique<Vulkan::GraphicsPipeline>(m_context, *desc);
+                }
+                else {
+                    pipeline.compute_pipeline = std::make_unique<Vulkan::ComputePipeline>(
+                        m_context, std::get<DnmGLLite::ComputePipelineDesc>(pipeline.desc));
+                }
+                compiled.count_down();
+            });
+        }
+        compiled.wait();
+
+        m_context.Message(std::format("{} pipelines precompiled", pipelines.size()), MessageType::eInfo);
+
+        // deleting is not thread safe, handles retired here on the calling thread
+        pipelines.clear();
+        shaders.clear();
+    }
+
+    void PipelineCache::Submit(std::function<void()> task) {
+        {
+            std::scoped_lock lock(m_task_mutex);
+            m_tasks.emplace_back(std::move(task));
+
+            if (m_workers.empty()) {
+                // one core left to the recording thread
+                const auto worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+                for ([[maybe_unused]] const auto i : Counter(worker_count)) {
+                    m_workers.emplace_back([this] (std::stop_token stop_token) { WorkerLoop(stop_token); });
+                }
+            }
+        }
+        m_task_condition.notify_one();
+    }
+
+    void PipelineCache::WorkerLoop(std::stop_token stop_token) {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(m_task_mutex);
+                m_task_condition.wait(lock, stop_token, [this] { return !m_tasks.empty(); });
+                // stopped, tasks left are still run
+                if (m_tasks.empty()) return;
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+}
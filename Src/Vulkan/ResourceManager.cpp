@@ -3,12 +3,32 @@
 #include "DnmGLLite/Vulkan/Image.hpp"
 #include "DnmGLLite/Vulkan/Buffer.hpp"
 #include "DnmGLLite/Vulkan/Sampler.hpp"
+#include "DnmGLLite/Vulkan/BindlessTable.hpp"
 #include <set>
 
 namespace DnmGLLite::Vulkan {
-    ResourceManager::ResourceManager(DnmGLLite::Vulkan::Context& ctx, std::span<const DnmGLLite::Shader*> shaders)
+    static vk::PipelineStageFlags GetShaderPipelineStage(vk::ShaderStageFlagBits stage) {
+        switch (stage) {
+            case vk::ShaderStageFlagBits::eVertex: return vk::PipelineStageFlagBits::eVertexShader;
+            case vk::ShaderStageFlagBits::eFragment: return vk::PipelineStageFlagBits::eFragmentShader;
+            case vk::ShaderStageFlagBits::eCompute: return vk::PipelineStageFlagBits::eComputeShader;
+            default: return vk::PipelineStageFlagBits::eAllCommands;
+        }
+    }
+
+    static vk::AccessFlags GetDescriptorAccess(vk::DescriptorType type, bool writable) {
+        switch (type) {
+            case vk::DescriptorType::eUniformBuffer: return vk::AccessFlagBits::eUniformRead;
+            case vk::DescriptorType::eStorageBuffer:
+            case vk::DescriptorType::eStorageImage: 
+                return writable ? vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite : vk::AccessFlagBits::eShaderRead;
+            default: return vk::AccessFlagBits::eShaderRead;
+        }
+    }
+
+    ResourceManager::ResourceManager(DnmGLLite::Vulkan::Context& ctx, std::span<const DnmGLLite::Shader*> shaders, bool allocate_sets)
         : DnmGLLite::ResourceManager(ctx, shaders) {
-        const auto* vk_ctx = VulkanContext;
+        auto* vk_ctx = VulkanContext;
 
         std::vector<std::vector<vk::DescriptorSetLayoutBinding>> set_bindings{};
 
@@ -21,6 +41,10 @@ namespace DnmGLLite::Vulkan {
                 auto& bindings = set_bindings[shader_dst_set.idx];
 
                 for (const auto& shader_binding : shader_dst_set.bindings) {
+                    auto& binding_access = m_binding_accesses[{shader_dst_set.idx, shader_binding.binding}];
+                    binding_access.stages |= GetShaderPipelineStage(typed_shader->GetStage());
+                    binding_access.access |= GetDescriptorAccess(shader_binding.type, shader_binding.writable);
+
                     auto it = std::ranges::find_if(
                             bindings,
                             [&shader_binding] (vk::DescriptorSetLayoutBinding& binding) {
@@ -44,7 +68,27 @@ namespace DnmGLLite::Vulkan {
             }
         }
 
-        for (const auto& bindings : set_bindings) {
+        // set 0 is the bindless table, its bindings in shaders are ignored
+        const auto* bindless_table = vk_ctx->GetBindlessTable();
+        if (bindless_table) {
+            if (set_bindings.empty()) set_bindings.resize(1);
+            m_dst_set_layouts.emplace_back(bindless_table->GetSetLayout());
+        }
+        const uint32_t first_owned_set = m_dst_set_layouts.size();
+
+        // per type total of every set, pool is chosen by it
+        std::vector<vk::DescriptorPoolSize> descriptor_counts{};
+        for (const auto& bindings : set_bindings | std::views::drop(first_owned_set)) {
+            for (const auto& binding : bindings) {
+                auto it = std::ranges::find(descriptor_counts, binding.descriptorType, &vk::DescriptorPoolSize::type);
+                if (it == descriptor_counts.end()) {
+                    descriptor_counts.emplace_back(binding.descriptorType, binding.descriptorCount);
+                }
+                else {
+                    it->descriptorCount += binding.descriptorCount;
+                }
+            }
+
             m_dst_set_layouts.emplace_back(vk_ctx->GetDevice().createDescriptorSetLayout(
                 vk::DescriptorSetLayoutCreateInfo{}
                 .setBindings(bindings)
@@ -52,14 +96,127 @@ namespace DnmGLLite::Vulkan {
             ));
         }
 
-        {
-            vk::DescriptorSetAllocateInfo alloc_info;
-            alloc_info.setSetLayouts(m_dst_set_layouts)
-                        .setDescriptorPool(vk_ctx->GetDescriptorPool())
-                        ;
+        if (allocate_sets) {
+            m_allocation = vk_ctx->GetDescriptorAllocator().Allocate(
+                std::span(m_dst_set_layouts).subspan(first_owned_set), descriptor_counts);
+
+            if (bindless_table) m_sets.emplace_back(bindless_table->GetSet());
+            m_sets.insert(m_sets.end(), m_allocation.sets.begin(), m_allocation.sets.end());
+
+            m_update_templates.resize(m_dst_set_layouts.size());
+            for (uint32_t set = first_owned_set; set < set_bindings.size(); ++set) {
+                CreateUpdateTemplate(set, set_bindings[set]);
+            }
+        }
+    }
+
+    void ResourceManager::TrackResource(uint32_t set, uint32_t binding, uint32_t array_element, Vulkan::Buffer* buffer, Vulkan::Image* image) {
+        const auto it = m_binding_accesses.find({set, binding});
+        if (it == m_binding_accesses.end()) return;
+
+        m_tracked_resources.insert_or_assign(
+            DescriptorSlot{set, binding, array_element}, 
+            TrackedResource{buffer, image, it->second.stages, it->second.access});
+    }
+
+    void ResourceManager::CreateUpdateTemplate(uint32_t set, std::span<const vk::DescriptorSetLayoutBinding> bindings) {
+        std::vector<vk::DescriptorSetLayoutBinding> sorted_bindings(bindings.begin(), bindings.end());
+        std::ranges::sort(sorted_bindings, {}, &vk::DescriptorSetLayoutBinding::binding);
+
+        auto& set_template = m_update_templates[set];
+        std::vector<vk::DescriptorUpdateTemplateEntry> entries{};
+
+        for (const auto& binding : sorted_bindings) {
+            // runtime arrays
+            if (binding.descriptorCount == 0) continue;
+
+            switch (binding.descriptorType) {
+                case vk::DescriptorType::eUniformBuffer:
+                case vk::DescriptorType::eStorageBuffer:
+                case vk::DescriptorType::eStorageImage:
+                case vk::DescriptorType::eCombinedImageSampler: break;
+                default: 
+                    set_template.descriptors.clear();
+                    return;
+            }
+
+            entries.emplace_back(vk::DescriptorUpdateTemplateEntry{}
+                .setDstBinding(binding.binding)
+                .setDstArrayElement(0)
+                .setDescriptorCount(binding.descriptorCount)
+                .setDescriptorType(binding.descriptorType)
+                .setOffset(set_template.descriptors.size() * sizeof(TemplateDescriptorInfo))
+                .setStride(sizeof(TemplateDescriptorInfo)));
+
+            for (uint32_t i{}; i < binding.descriptorCount; ++i) {
+                set_template.descriptors.emplace_back(binding.binding, i, binding.descriptorType);
+            }
+        }
+        if (set_template.descriptors.empty()) return;
+
+        set_template.update_template = VulkanContext->GetDevice().createDescriptorUpdateTemplate(
+            vk::DescriptorUpdateTemplateCreateInfo{}
+                .setDescriptorUpdateEntries(entries)
+                .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+                .setDescriptorSetLayout(m_dst_set_layouts[set]));
+    }
+
+    void ResourceManager::SetResources(uint32_t set, std::span<const DescriptorResource> resources) {
+        DnmGLLiteAssert(set < m_update_templates.size() && m_update_templates[set].update_template, 
+            "set {} has no update template (bindless table, empty or has unsupported descriptor types)", set)
+
+        const auto& set_template = m_update_templates[set];
+        DnmGLLiteAssert(resources.size() == set_template.descriptors.size(), 
+            "set {} has {} descriptors but {} resources given", set, set_template.descriptors.size(), resources.size())
+
+        for (const auto& [descriptor, res] : std::views::zip(set_template.descriptors, resources)) {
+            const bool is_buffer = descriptor.type == vk::DescriptorType::eUniformBuffer || descriptor.type == vk::DescriptorType::eStorageBuffer;
+            TrackResource(set, descriptor.binding, descriptor.array_element, 
+                is_buffer ? static_cast<Vulkan::Buffer*>(res.buffer) : nullptr,
+                is_buffer ? nullptr : static_cast<Vulkan::Image*>(res.image));
+        }
+
+        const auto context_state = VulkanContext->GetContextState();
+        // sets may still be bound by previous frames that gpu is executing
+        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone 
+            || (context_state == Vulkan::ContextState::eCommandBufferRecording && !VulkanContext->IsAnyFrameInFlight());
+
+        m_template_data.resize(resources.size());
+        for (const auto& [descriptor, res, info] : std::views::zip(set_template.descriptors, resources, m_template_data)) {
+            switch (descriptor.type) {
+                case vk::DescriptorType::eUniformBuffer:
+                case vk::DescriptorType::eStorageBuffer:
+                    info.buffer = VkDescriptorBufferInfo{
+                        .buffer = static_cast<VkBuffer>(static_cast<const Vulkan::Buffer*>(res.buffer)->GetBuffer()),
+                        .offset = res.offset,
+                        .range = res.size,
+                    }; break;
+                case vk::DescriptorType::eStorageImage:
+                    info.image = VkDescriptorImageInfo{
+                        .sampler = VK_NULL_HANDLE,
+                        .imageView = static_cast<VkImageView>(static_cast<Vulkan::Image*>(res.image)->CreateGetImageView(res.subresource)),
+                        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                    }; break;
+                default:
+                    info.image = VkDescriptorImageInfo{
+                        .sampler = static_cast<VkSampler>(static_cast<Vulkan::Sampler*>(res.sampler)->GetSampler()),
+                        .imageView = static_cast<VkImageView>(static_cast<Vulkan::Image*>(res.image)->CreateGetImageView(res.subresource)),
+                        .imageLayout = static_cast<VkImageLayout>(GetIdealImageLayout(res.image->GetDesc().usage_flags)),
+                    }; break;
+            }
+        }
 
-            m_sets = vk_ctx->GetDevice().allocateDescriptorSets(alloc_info);
+        if (!context_state_is_ideal) {
+            const auto data = std::as_bytes(std::span(m_template_data));
+            VulkanContext->DeferResourceUpdate(Context::InternalTemplateUpdate{
+                .set = m_sets[set],
+                .update_template = set_template.update_template,
+                .data = std::vector(data.begin(), data.end()),
+            });
+            return;
         }
+
+        VulkanContext->GetDevice().updateDescriptorSetWithTemplate(m_sets[set], set_template.update_template, m_template_data.data());
     }
 
     void ResourceManager::SetResourceAsBuffer(std::span<const BufferResource> update_resource) {
@@ -82,7 +239,9 @@ namespace DnmGLLite::Vulkan {
         }
         
         const auto context_state = VulkanContext->GetContextState();
-        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone || context_state == Vulkan::ContextState::eCommandBufferRecording;
+        // sets may still be bound by previous frames that gpu is executing
+        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone 
+            || (context_state == Vulkan::ContextState::eCommandBufferRecording && !VulkanContext->IsAnyFrameInFlight());
 
         for (const auto& res : update_resource) {
             bool update_now = context_state_is_ideal;
@@ -104,6 +263,8 @@ namespace DnmGLLite::Vulkan {
             internal_res.offset = res.offset;
             internal_res.size = res.size;
             internal_res.set = m_sets[res.set];
+
+            TrackResource(res.set, res.binding, res.array_element, static_cast<Vulkan::Buffer*>(res.buffer), nullptr);
         }
         if (!defer_updates.empty()) {
             VulkanContext->DeferResourceUpdate(defer_updates);
@@ -136,7 +297,9 @@ namespace DnmGLLite::Vulkan {
         }
 
         const auto context_state = VulkanContext->GetContextState();
-        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone || context_state == Vulkan::ContextState::eCommandBufferRecording;
+        // sets may still be bound by previous frames that gpu is executing
+        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone 
+            || (context_state == Vulkan::ContextState::eCommandBufferRecording && !VulkanContext->IsAnyFrameInFlight());
 
         for (const auto& res : update_resource) {
             auto& internal_res
@@ -146,6 +309,8 @@ namespace DnmGLLite::Vulkan {
             internal_res.array_element = res.array_element;
             internal_res.binding = res.binding;
             internal_res.set = m_sets[res.set];
+
+            TrackResource(res.set, res.binding, res.array_element, nullptr, static_cast<Vulkan::Image*>(res.image));
         }
         if (!defer_updates.empty()) {
             VulkanContext->DeferResourceUpdate(defer_updates);
@@ -178,7 +343,9 @@ namespace DnmGLLite::Vulkan {
         }
 
         const auto context_state = VulkanContext->GetContextState();
-        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone || context_state == Vulkan::ContextState::eCommandBufferRecording;
+        // sets may still be bound by previous frames that gpu is executing
+        const bool context_state_is_ideal = context_state == Vulkan::ContextState::eNone 
+            || (context_state == Vulkan::ContextState::eCommandBufferRecording && !VulkanContext->IsAnyFrameInFlight());
 
         uint32_t i{};
         for (const auto& res : update_resource) {
@@ -192,6 +359,8 @@ namespace DnmGLLite::Vulkan {
             internal_res.binding = res.binding;
             internal_res.set = m_sets[res.set];
             ++i;
+
+            TrackResource(res.set, res.binding, res.array_element, nullptr, static_cast<Vulkan::Image*>(res.image));
         }
         if (!defer_updates.empty()) {
             VulkanContext->DeferResourceUpdate(defer_updates);
@@ -1,4 +1,5 @@
 #include "DnmGLLite/Vulkan/Sampler.hpp"
+#include "DnmGLLite/Vulkan/BindlessTable.hpp"
 
 namespace DnmGLLite::Vulkan {
     Sampler::Sampler(DnmGLLite::Vulkan::Context& context, const DnmGLLite::SamplerDesc& desc)
@@ -35,5 +36,16 @@ namespace DnmGLLite::Vulkan {
                     ;
 
         m_sampler = context.GetDevice().createSampler(create_info);
+
+        if (auto* bindless_table = context.GetBindlessTable()) {
+            m_bindless_index = bindless_table->AddSampler(m_sampler);
+        }
+    }
+
+    Sampler::~Sampler() {
+        if (auto* bindless_table = VulkanContext->GetBindlessTable()) {
+            bindless_table->Remove(BindlessArray::eSampler, m_bindless_index, VulkanContext->GetRetireTicket());
+        }
+        VulkanContext->DeleteObject(m_sampler);
     }
 }
\ No newline at end of file
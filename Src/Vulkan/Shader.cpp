@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <type_traits>
 
 namespace DnmGLLite::Vulkan {
     static constexpr std::vector<uint32_t> LoadShaderFile(const std::filesystem::path& filePath) {
@@ -55,22 +56,13 @@ namespace DnmGLLite::Vulkan {
         return {};
     }
 
-    Shader::Shader(Vulkan::Context& ctx, const std::filesystem::path& path) : DnmGLLite::Shader(ctx, path) {
-        if (std::filesystem::exists(path))
-            VulkanContext->Message(std::format("file not exists, {}", std::filesystem::absolute(path).string()), 
-                MessageType::eInvalidBehavior);
+    static ShaderReflection Reflect(std::span<const uint32_t> code) {
+        ShaderReflection out{};
 
-        const auto shaderCode = LoadShaderFile(m_path);
-
-        //create shader module
-        m_shader_module = VulkanContext->GetDevice().createShaderModule(
-            vk::ShaderModuleCreateInfo{}.setCode(shaderCode));
-        
-        //create shader reflection
-        spv_reflect::ShaderModule reflect(shaderCode);
-        m_stage = static_cast<vk::ShaderStageFlagBits>(reflect.GetShaderStage());
-        m_buffer_resource_access_info.stages = ShaderStageToPipelineStage(m_stage);
-        m_image_resource_access_info.stages = ShaderStageToPipelineStage(m_stage);
+        spv_reflect::ShaderModule reflect(code.size_bytes(), code.data());
+        out.stage = static_cast<vk::ShaderStageFlagBits>(reflect.GetShaderStage());
+        out.buffer_resource_access_info.stages = ShaderStageToPipelineStage(out.stage);
+        out.image_resource_access_info.stages = ShaderStageToPipelineStage(out.stage);
 
         {
             uint32_t count;
@@ -79,20 +71,21 @@ namespace DnmGLLite::Vulkan {
             reflect.EnumerateDescriptorSets(&count, dst_sets.data());
 
             for (const auto* set : dst_sets) {
-                auto& set_info = m_descriptor_sets.emplace_back();
+                auto& set_info = out.descriptor_sets.emplace_back();
                 set_info.idx = set->set;
 
                 for (auto i : Counter(set->binding_count)) {
                     const auto* binding = set->bindings[i];
-                    const auto resource_type = static_cast<vk::DescriptorType>(binding->descriptor_type);
 
                     set_info.bindings.emplace_back(
                         binding->binding,
                         binding->count,
-                        static_cast<vk::DescriptorType>(binding->descriptor_type)
+                        static_cast<vk::DescriptorType>(binding->descriptor_type),
+                        binding->resource_type == SPV_REFLECT_RESOURCE_FLAG_UAV
+                            && !(binding->decoration_flags & SPV_REFLECT_DECORATION_NON_WRITABLE)
                     );
 
-                    FillResAccessInfo(*binding, m_buffer_resource_access_info, m_image_resource_access_info);
+                    FillResAccessInfo(*binding, out.buffer_resource_access_info, out.image_resource_access_info);
                 }
             }
         }
@@ -106,14 +99,205 @@ namespace DnmGLLite::Vulkan {
             reflect.EnumeratePushConstantBlocks(&count, pushConstants.data());
 
             if (count != 0) {
-                m_push_constant = PushConstant {
+                out.push_constant = ShaderReflection::PushConstant {
                 pushConstants[0]->size,
                 pushConstants[0]->offset,
                 };
                 DnmGLLiteAssert(
-                    m_push_constant->offset + m_push_constant->size < 128, 
+                    out.push_constant->offset + out.push_constant->size < 128, 
                     "push constant offset + size should be small 128 byte")
             }
         }
+
+        {
+            uint32_t count = 0;
+            auto result = reflect.EnumerateSpecializationConstants(&count, nullptr);
+            DnmGLLiteAssert(result == SPV_REFLECT_RESULT_SUCCESS, "failed to enumerate specialization constants, result {}", static_cast<int>(result))
+            std::vector<SpvReflectSpecializationConstant*> constants(count);
+            result = reflect.EnumerateSpecializationConstants(&count, constants.data());
+            DnmGLLiteAssert(result == SPV_REFLECT_RESULT_SUCCESS, "failed to enumerate specialization constants, result {}", static_cast<int>(result))
+
+            for (const auto* constant : constants) {
+                out.specialization_constant_ids.emplace_back(constant->constant_id);
+            }
+            std::ranges::sort(out.specialization_constant_ids);
+        }
+
+        return out;
+    }
+
+    // FNV-1a, stable between runs unlike std::hash
+    static uint64_t HashCode(std::span<const uint32_t> code) {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (const auto byte : std::as_bytes(code)) {
+            hash = (hash ^ static_cast<uint8_t>(byte)) * 0x100000001b3;
+        }
+        return hash;
+    }
+
+    // reflection cache file: header, then entries written field by field
+    struct ShaderCacheFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entry_count;
+    };
+
+    static constexpr uint32_t shader_cache_magic = 0x53474C44; // "DLGS"
+    // bump when ShaderReflection changes
+    static constexpr uint32_t shader_cache_version = 3;
+
+    template <typename T>
+    static void WriteRaw(std::ostream& stream, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static T ReadRaw(std::istream& stream) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    static void WriteAccessInfo(std::ostream& stream, const ResourceAccessInfo& info) {
+        WriteRaw(stream, static_cast<uint8_t>(info.type));
+        WriteRaw(stream, static_cast<uint8_t>(info.access));
+        WriteRaw(stream, static_cast<VkPipelineStageFlags>(info.stages));
+    }
+
+    static ResourceAccessInfo ReadAccessInfo(std::istream& stream) {
+        ResourceAccessInfo info{};
+        info.type = ResourceTypeFlag(ReadRaw<uint8_t>(stream));
+        info.access = ResourceAccessFlag(ReadRaw<uint8_t>(stream));
+        info.stages = vk::PipelineStageFlags(ReadRaw<VkPipelineStageFlags>(stream));
+        return info;
+    }
+
+    ShaderCache::ShaderCache(Vulkan::Context& context, const std::filesystem::path& path)
+        : m_context(context),
+        m_path(path) {
+        if (!m_path.empty()) Load();
+    }
+
+    ShaderCache::~ShaderCache() {
+        Save();
+    }
+
+    void ShaderCache::Load() {
+        std::ifstream file(m_path, std::ios::binary);
+        if (!file) return;
+
+        const auto header = ReadRaw<ShaderCacheFileHeader>(file);
+        if (!file || header.magic != shader_cache_magic || header.version != shader_cache_version) return;
+
+        // one broken entry drops the whole file, shaders are reflected again
+        std::map<Key, ShaderReflection> reflections{};
+        for ([[maybe_unused]] const auto i : Counter(header.entry_count)) {
+            const auto key = ReadRaw<Key>(file);
+
+            ShaderReflection reflection{};
+            reflection.stage = ReadRaw<vk::ShaderStageFlagBits>(file);
+            reflection.buffer_resource_access_info = ReadAccessInfo(file);
+            reflection.image_resource_access_info = ReadAccessInfo(file);
+            if (ReadRaw<uint8_t>(file)) {
+                reflection.push_constant = ReadRaw<ShaderReflection::PushConstant>(file);
+            }
+
+            reflection.specialization_constant_ids.resize(ReadRaw<uint32_t>(file));
+            for (auto& id : reflection.specialization_constant_ids) {
+                id = ReadRaw<uint32_t>(file);
+            }
+
+            reflection.descriptor_sets.resize(ReadRaw<uint32_t>(file));
+            for (auto& set : reflection.descriptor_sets) {
+                set.idx = ReadRaw<uint32_t>(file);
+                set.bindings.resize(ReadRaw<uint32_t>(file));
+                for (auto& binding : set.bindings) {
+                    binding = ReadRaw<ShaderReflection::BindingInfo>(file);
+                }
+                if (!file) return;
+            }
+            if (!file) return;
+
+            reflections.emplace(key, std::move(reflection));
+        }
+
+        m_reflections = std::move(reflections);
+    }
+
+    void ShaderCache::Save() {
+        if (m_path.empty() || !m_modified) return;
+
+        std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+        WriteRaw(file, ShaderCacheFileHeader{
+            .magic = shader_cache_magic,
+            .version = shader_cache_version,
+            .entry_count = static_cast<uint32_t>(m_reflections.size()),
+        });
+
+        for (const auto& [key, reflection] : m_reflections) {
+            WriteRaw(file, key);
+            WriteRaw(file, reflection.stage);
+            WriteAccessInfo(file, reflection.buffer_resource_access_info);
+            WriteAccessInfo(file, reflection.image_resource_access_info);
+            WriteRaw(file, static_cast<uint8_t>(reflection.push_constant.has_value()));
+            if (reflection.push_constant.has_value()) {
+                WriteRaw(file, *reflection.push_constant);
+            }
+
+            WriteRaw(file, static_cast<uint32_t>(reflection.specialization_constant_ids.size()));
+            for (const auto id : reflection.specialization_constant_ids) {
+                WriteRaw(file, id);
+            }
+
+            WriteRaw(file, static_cast<uint32_t>(reflection.descriptor_sets.size()));
+            for (const auto& set : reflection.descriptor_sets) {
+                WriteRaw(file, set.idx);
+                WriteRaw(file, static_cast<uint32_t>(set.bindings.size()));
+                for (const auto& binding : set.bindings) {
+                    WriteRaw(file, binding);
+                }
+            }
+        }
+
+        if (!file) {
+            m_context.Message(std::format("failed to write shader cache, {}", m_path.string()), MessageType::eInvalidBehavior);
+            return;
+        }
+        m_modified = false;
+    }
+
+    std::shared_ptr<const ShaderData> ShaderCache::GetShaderData(std::span<const uint32_t> code) {
+        const Key key{HashCode(code), code.size_bytes()};
+
+        if (auto data = m_shaders[key].lock()) {
+            return data;
+        }
+
+        auto reflection_it = m_reflections.find(key);
+        if (reflection_it == m_reflections.end()) {
+            reflection_it = m_reflections.emplace(key, Reflect(code)).first;
+            m_modified = true;
+        }
+
+        const auto shader_module = m_context.GetDevice().createShaderModule(
+            vk::ShaderModuleCreateInfo{}
+                .setCodeSize(code.size_bytes())
+                .setPCode(code.data()));
+
+        auto data = std::make_shared<const ShaderData>(m_context, shader_module, reflection_it->second);
+        m_shaders[key] = data;
+        return data;
+    }
+
+    Shader::Shader(Vulkan::Context& ctx, const std::filesystem::path& path) : DnmGLLite::Shader(ctx, path) {
+        if (!std::filesystem::exists(path))
+            VulkanContext->Message(std::format("file not exists, {}", std::filesystem::absolute(path).string()), 
+                MessageType::eInvalidBehavior);
+
+        const auto shaderCode = LoadShaderFile(m_path);
+
+        m_data = VulkanContext->GetShaderCache().GetShaderData(shaderCode);
     }
 }
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "DnmGLLite/Vulkan/UploadEngine.hpp"
+#include "DnmGLLite/Vulkan/Buffer.hpp"
+#include "DnmGLLite/Vulkan/Image.hpp"
+#include <vma/vk_mem_alloc.h>
+#include <cstring>
+
+namespace DnmGLLite::Vulkan {
+    UploadEngine::UploadEngine(Vulkan::Context& context, uint32_t staging_buffer_size)
+        : m_context(context),
+        m_graphics_queue_family(context.GetDeviceFeatures().queue_family),
+        m_transfer_queue_family(context.GetDeviceFeatures().transfer_queue_family),
+        m_transfer_queue(context.GetTransferQueue()) {
+        const auto device = m_context.GetDevice();
+
+        vk::CommandPoolCreateInfo pool_create_info{};
+        pool_create_info.setQueueFamilyIndex(m_transfer_queue_family);
+
+        // one more than frames, flushing rarely waits a batch fence
+        m_batches.resize(m_context.GetFramesInFlight() + 1);
+        for (auto& batch : m_batches) {
+            batch.command_pool = device.createCommandPool(pool_create_info);
+            batch.command_buffer = device.allocateCommandBuffers(
+                vk::CommandBufferAllocateInfo{}
+                    .setCommandPool(batch.command_pool)
+                    .setCommandBufferCount(1)
+                    .setLevel(vk::CommandBufferLevel::ePrimary))[0];
+            batch.fence = device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+            batch.semaphore = device.createSemaphore({});
+
+            if (staging_buffer_size) {
+                batch.staging_buffer = new Vulkan::Buffer(m_context, {
+                    .size = staging_buffer_size,
+                    .memory_host_access = MemoryHostAccess::eWrite,
+                    .memory_type = MemoryType::eHostMemory,
+                    .buffer_flags = {},
+                });
+            }
+        }
+    }
+
+    UploadEngine::~UploadEngine() {
+        const auto device = m_context.GetDevice();
+
+        for (const auto& batch : m_batches) {
+            [[maybe_unused]] auto _ = device.waitForFences(batch.fence, vk::True, UINT64_MAX);
+        }
+
+        for (auto& batch : m_batches) {
+            DeleteOverflowBuffers(batch);
+            if (batch.staging_buffer) delete batch.staging_buffer;
+            device.destroy(batch.semaphore);
+            device.destroy(batch.fence);
+            device.destroy(batch.command_pool);
+        }
+    }
+
+    UploadEngine::Batch& UploadEngine::GetRecordingBatch() {
+        auto& batch = m_batches[m_batch_index];
+        if (m_recording) return batch;
+
+        const auto device = m_context.GetDevice();
+        [[maybe_unused]] auto _ = device.waitForFences(batch.fence, vk::True, UINT64_MAX);
+        DeleteOverflowBuffers(batch);
+
+        device.resetCommandPool(batch.command_pool);
+        batch.command_buffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        batch.staging_offset = 0;
+        m_recording = true;
+        return batch;
+    }
+
+    std::pair<vk::Buffer, uint32_t> UploadEngine::WriteStaging(Batch& batch, const void* data, uint32_t size, uint32_t alignment) {
+        // same rounding as Context::AllocateStaging
+        const uint32_t staging_offset = (batch.staging_offset + alignment - 1) / alignment * alignment;
+
+        if (batch.staging_buffer && uint64_t(staging_offset) + size <= batch.staging_buffer->GetDesc().size) {
+            memcpy(batch.staging_buffer->GetMappedPtr() + staging_offset, data, size);
+            batch.staging_offset = staging_offset + size;
+            return {batch.staging_buffer->GetBuffer(), staging_offset};
+        }
+
+        // too big for the staging buffer, kept until the transfer queue finishes the batch
+        const auto* staging_buffer = batch.overflow_buffers.emplace_back(new Vulkan::Buffer(m_context, {
+            .size = size,
+            .memory_host_access = MemoryHostAccess::eWrite,
+            .memory_type = MemoryType::eAuto,
+            .buffer_flags = {},
+        }));
+        memcpy(staging_buffer->GetMappedPtr(), data, size);
+        vmaFlushAllocation(m_context.GetVmaAllocator(), staging_buffer->GetAllocation(), 0, size);
+        return {staging_buffer->GetBuffer(), 0};
+    }
+
+    void UploadEngine::DeleteOverflowBuffers(Batch& batch) {
+        for (const auto* buffer : batch.overflow_buffers) {
+            delete buffer;
+        }
+        batch.overflow_buffers.clear();
+    }
+
+    void UploadEngine::UploadData(const Vulkan::Buffer* buffer, const void* data, uint32_t size, uint32_t offset) {
+        auto& batch = GetRecordingBatch();
+
+        const auto [src_buffer, src_offset] = WriteStaging(batch, data, size, 4);
+
+        batch.command_buffer.copyBuffer(
+            src_buffer,
+            buffer->GetBuffer(),
+            vk::BufferCopy(src_offset, offset, size));
+
+        AddReleaseBarrier(buffer);
+    }
+
+    void UploadEngine::UploadData(Vulkan::Image* image, const ImageSubresource& subresource, const void* data, uint32_t size, Uint3 offset) {
+        auto& batch = GetRecordingBatch();
+
+        if (!m_batch_resources.contains(image)) {
+            // initial transition of new images done here instead of graphics queue
+            if (m_context.TakeDeferredImageLayoutTransfer(image->GetImage())) {
+                image->SetImageLayout(vk::ImageLayout::eUndefined);
+            }
+
+            // subresources can be in different layouts, one barrier per block of the same layout
+            std::vector<vk::ImageMemoryBarrier> barriers{};
+            image->AddLayoutBarriers(
+                barriers, whole_image_range, vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite);
+
+            batch.command_buffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTopOfPipe,
+                vk::PipelineStageFlagBits::eTransfer,
+                {},
+                {},
+                {},
+                barriers);
+
+            AddReleaseBarrier(image, image->GetIdealImageLayout());
+        }
+
+        const auto [src_buffer, src_offset] = WriteStaging(batch, data, size, image->GetCopyAlignment());
+
+        // same regions as CommandBuffer::UploadData
+        const vk::BufferImageCopy buffer_image_copy {
+            src_offset,
+            image->GetDesc().extent.x,
+            image->GetDesc().extent.y,
+            vk::ImageSubresourceLayers(
+                image->GetAspect(),
+                subresource.base_mipmap,
+                subresource.base_layer,
+                subresource.layer_count
+            ),
+            vk::Offset3D(offset.x, offset.y, offset.z),
+            vk::Extent3D(image->GetDesc().extent.x, image->GetDesc().extent.y, image->GetDesc().extent.z)
+        };
+
+        batch.command_buffer.copyBufferToImage(
+            src_buffer,
+            image->GetImage(),
+            vk::ImageLayout::eTransferDstOptimal,
+            buffer_image_copy);
+    }
+
+    void UploadEngine::AddReleaseBarrier(const Vulkan::Buffer* buffer) {
+        if (!m_batch_resources.emplace(buffer).second) return;
+
+        // concurrent resources need no ownership transfer
+        const bool transfer_ownership = HasOwnershipTransfer() && buffer->GetSharingMode() == vk::SharingMode::eExclusive;
+        const auto src_family = transfer_ownership ? m_transfer_queue_family : VK_QUEUE_FAMILY_IGNORED;
+        const auto dst_family = transfer_ownership ? m_graphics_queue_family : VK_QUEUE_FAMILY_IGNORED;
+
+        m_release_buffer_barriers.emplace_back(
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlags{},
+            src_family,
+            dst_family,
+            buffer->GetBuffer(),
+            0,
+            VK_WHOLE_SIZE
+        );
+    }
+
+    void UploadEngine::AddReleaseBarrier(Vulkan::Image* image, vk::ImageLayout new_layout) {
+        if (!m_batch_resources.emplace(image).second) return;
+
+        // concurrent resources need no ownership transfer, but layout transition still happens here
+        const bool transfer_ownership = HasOwnershipTransfer() && image->GetSharingMode() == vk::SharingMode::eExclusive;
+        const auto src_family = transfer_ownership ? m_transfer_queue_family : VK_QUEUE_FAMILY_IGNORED;
+        const auto dst_family = transfer_ownership ? m_graphics_queue_family : VK_QUEUE_FAMILY_IGNORED;
+
+        m_release_image_barriers.emplace_back(
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlags{},
+            vk::ImageLayout::eTransferDstOptimal,
+            new_layout,
+            src_family,
+            dst_family,
+            image->GetImage(),
+            vk::ImageSubresourceRange(image->GetAspect(), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
+        );
+
+        // graphics queue sees it in new layout after acquire
+        image->SetImageLayout(new_layout);
+    }
+
+    void UploadEngine::Flush() {
+        // previous copies not acquired yet, their semaphore has a pending signal
+        if (!m_recording || m_waiting_acquire) return;
+
+        auto& batch = m_batches[m_batch_index];
+
+        batch.command_buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eBottomOfPipe,
+            {},
+            {},
+            m_release_buffer_barriers,
+            m_release_image_barriers);
+        batch.command_buffer.end();
+
+        if (batch.staging_offset) {
+            vmaFlushAllocation(m_context.GetVmaAllocator(), batch.staging_buffer->GetAllocation(), 0, batch.staging_offset);
+        }
+
+        vk::SubmitInfo submit_info{};
+        submit_info.setCommandBuffers(batch.command_buffer)
+                   .setSignalSemaphores(batch.semaphore);
+
+        m_context.GetDevice().resetFences(batch.fence);
+        m_transfer_queue.submit(submit_info, batch.fence);
+
+        // release and acquire must match, except access and stage masks
+        if (HasOwnershipTransfer()) {
+            for (auto barrier : m_release_buffer_barriers) {
+                if (barrier.srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) continue;
+                m_acquire_buffer_barriers.emplace_back(barrier
+                    .setSrcAccessMask({})
+                    .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite));
+            }
+            for (auto barrier : m_release_image_barriers) {
+                if (barrier.srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) continue;
+                m_acquire_image_barriers.emplace_back(barrier
+                    .setSrcAccessMask({})
+                    .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite));
+            }
+        }
+        m_release_buffer_barriers.resize(0);
+        m_release_image_barriers.resize(0);
+        m_batch_resources.clear();
+
+        batch.serial = ++m_submitted_serial;
+        m_submitted_batch_index = m_batch_index;
+        m_batch_index = (m_batch_index + 1) % m_batches.size();
+        m_recording = false;
+        m_waiting_acquire = true;
+    }
+
+    uint64_t UploadEngine::GetCompletedValue() {
+        // fences of one queue signal in submit order
+        for (const auto& batch : m_batches) {
+            if (batch.serial > m_completed_serial 
+                && m_context.GetDevice().getFenceStatus(batch.fence) == vk::Result::eSuccess) {
+                m_completed_serial = batch.serial;
+            }
+        }
+        return m_completed_serial;
+    }
+
+    void UploadEngine::RecordAcquire(vk::CommandBuffer command_buffer) const {
+        if (!m_waiting_acquire || (m_acquire_buffer_barriers.empty() && m_acquire_image_barriers.empty())) return;
+
+        command_buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe,
+            vk::PipelineStageFlagBits::eAllCommands,
+            {},
+            {},
+            m_acquire_buffer_barriers,
+            m_acquire_image_barriers);
+    }
+
+    void UploadEngine::OnGraphicsSubmit() {
+        m_acquire_buffer_barriers.resize(0);
+        m_acquire_image_barriers.resize(0);
+        m_waiting_acquire = false;
+    }
+}
@@ -0,0 +1,104 @@
+#include "DnmGLLite/DnmGLLite.hpp"
+#include "DnmGLLite/Sprite.hpp"
+
+#ifdef _WIN32
+    #include "DnmGLLite/Loaders/Windows.hpp"
+    using ContextLoader = DnmGLLite::Windows::ContextLoader;
+#else
+    #include "DnmGLLite/Loaders/Linux.hpp"
+    using ContextLoader = DnmGLLite::Linux::ContextLoader;
+#endif
+
+#include <cstring>
+#include <print>
+
+// renders and reads back more frames than there are frame slots, so every slot is begun again.
+// the readback copies GetRenderTargetImage in another frame than the render, so it needs the image
+// of the last Render and a wait for its writes. a command buffer keeping the bound state of its 
+// previous frame skips BindPipeline and the sprite isn't drawn in later frames
+constexpr DnmGLLite::Uint2 extent = {64, 64};
+constexpr uint32_t frames_in_flight = 2;
+
+int main() {
+    ContextLoader loader(DNMGLLITE_VULKAN_LIB);
+    auto* context = loader.GetContext();
+    if (!context) {
+        std::println("failed to load {}", DNMGLLITE_VULKAN_LIB);
+        return 1;
+    }
+
+    context->Init({
+        .window_extent = extent,
+        .window_handle = std::nullopt,
+        .Vsync = false,
+        .frames_in_flight = frames_in_flight,
+    });
+
+    DnmGLLite::SpriteManager sprite_manager({
+        .context = context,
+        .atlas_texture = nullptr,
+        .extent = extent,
+        .msaa = DnmGLLite::SampleCount::e1,
+        .init_capacity = 1,
+    });
+
+    DnmGLLite::SpriteCamera camera({1, 1}, 0.1, 10);
+    camera.CalculateProjMtx();
+    sprite_manager.SetCamera(&camera);
+
+    // opaque white over the center
+    sprite_manager.CreateSprite(DnmGLLite::SpriteData{
+        .color = {1, 1, 1, 1},
+        .position = {0, 0},
+        .scale = {0.5, 0.5},
+        .angle = 0,
+        .color_factor = 1.f,
+    });
+
+    auto readback = context->CreateBuffer({
+        .size = sizeof(uint32_t),
+        .memory_host_access = DnmGLLite::MemoryHostAccess::eReadWrite,
+        .memory_type = DnmGLLite::MemoryType::eHostMemory,
+        .buffer_flags = DnmGLLite::BufferUsageBits::eStorage,
+    });
+
+    int result = 0;
+    for (uint32_t frame{}; frame < frames_in_flight * 2 + 1; ++frame) {
+        context->Render([&] (DnmGLLite::CommandBuffer* command_buffer) -> bool {
+            command_buffer->SetScissor(extent, {0, 0});
+            command_buffer->SetViewport({float(extent.x), float(extent.y)}, {0, 0}, 0.f, 1.f);
+            sprite_manager.RenderSprites(command_buffer, {0, 0, 0, 0});
+            return true;
+        });
+
+        std::memset(readback->GetMappedPtr<uint32_t>(), 0, sizeof(uint32_t));
+        context->ExecuteCommands([&] (DnmGLLite::CommandBuffer* command_buffer) -> bool {
+            command_buffer->CopyImageToBuffer({
+                .src_image = context->GetRenderTargetImage(),
+                .dst_buffer = readback.get(),
+                .image_subresource = {},
+                .buffer_offset = 0,
+                .buffer_row_lenght = 0,
+                .buffer_image_height = 0,
+                .image_offset = {extent.x / 2, extent.y / 2, 0},
+                .image_extent = {1, 1, 1},
+            });
+            // mapped read below
+            constexpr DnmGLLite::ResourceBarrierDesc host_read{
+                .src_usage = DnmGLLite::ResourceUsage::eTransferWrite, 
+                .dst_usage = DnmGLLite::ResourceUsage::eHostRead,
+            };
+            command_buffer->Barrier({&host_read, 1});
+            return true;
+        }).Wait();
+
+        const auto center = *readback->GetMappedPtr<uint32_t>();
+        if (center == 0) {
+            std::println("frame {}: sprite not drawn", frame);
+            result = 1;
+        }
+    }
+
+    context->WaitForGPU();
+    return result;
+}
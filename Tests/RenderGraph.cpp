@@ -0,0 +1,111 @@
+#include "DnmGLLite/DnmGLLite.hpp"
+#include "DnmGLLite/RenderGraph.hpp"
+
+#ifdef _WIN32
+    #include "DnmGLLite/Loaders/Windows.hpp"
+    using ContextLoader = DnmGLLite::Windows::ContextLoader;
+#else
+    #include "DnmGLLite/Loaders/Linux.hpp"
+    using ContextLoader = DnmGLLite::Linux::ContextLoader;
+#endif
+
+#include <array>
+#include <print>
+
+// compiles a chain of passes through transient images into a buffer, with one pass nothing reads.
+// checks the culled pass, which transients share memory and the barriers before each pass
+using DnmGLLite::ResourceUsage;
+using DnmGLLite::ResourceBarrierDesc;
+
+static int result = 0;
+
+static void Check(bool condition, std::string_view what) {
+    if (condition) return;
+    std::println("{}", what);
+    result = 1;
+}
+
+static void CheckBarriers(const DnmGLLite::RenderGraph& graph, uint32_t pass, std::span<const ResourceBarrierDesc> expected) {
+    const auto barriers = graph.GetPassBarriers(pass);
+    Check(std::ranges::equal(barriers, expected), std::format("pass {}: unexpected barriers", pass));
+}
+
+int main() {
+    ContextLoader loader(DNMGLLITE_VULKAN_LIB);
+    auto* context = loader.GetContext();
+    if (!context) {
+        std::println("failed to load {}", DNMGLLITE_VULKAN_LIB);
+        return 1;
+    }
+
+    context->Init({
+        .window_extent = {64, 64},
+        .window_handle = std::nullopt,
+        .Vsync = false,
+    });
+
+    auto buffer = context->CreateBuffer({
+        .size = 256,
+        .memory_host_access = DnmGLLite::MemoryHostAccess::eNone,
+        .memory_type = DnmGLLite::MemoryType::eDeviceMemory,
+        .buffer_flags = DnmGLLite::BufferUsageBits::eStorage,
+    });
+
+    const DnmGLLite::ImageDesc transient_desc{
+        .extent = {64, 64, 1},
+        .format = DnmGLLite::Format::eRGBA8Norm,
+        .usage_flags = DnmGLLite::ImageUsageBits::eColorAttachment | DnmGLLite::ImageUsageBits::eSampled,
+        .type = DnmGLLite::ImageType::e2D,
+    };
+
+    DnmGLLite::RenderGraph graph(*context);
+    const auto output = graph.ImportBuffer(buffer.get());
+    const auto unused = graph.CreateImage(transient_desc);
+    const auto first = graph.CreateImage(transient_desc);
+    const auto second = graph.CreateImage(transient_desc);
+    const auto third = graph.CreateImage(transient_desc);
+
+    const auto empty_pass = [] (DnmGLLite::RenderGraph&, DnmGLLite::CommandBuffer*) {};
+    // 0, written but never read
+    graph.AddPass("unused", std::array{DnmGLLite::RenderGraphAccess{unused, ResourceUsage::eColorAttachment}}, empty_pass);
+    // 1 to 4
+    graph.AddPass("first", std::array{DnmGLLite::RenderGraphAccess{first, ResourceUsage::eColorAttachment}}, empty_pass);
+    graph.AddPass("second", std::array{
+        DnmGLLite::RenderGraphAccess{first, ResourceUsage::eShaderRead},
+        DnmGLLite::RenderGraphAccess{second, ResourceUsage::eColorAttachment},
+    }, empty_pass);
+    graph.AddPass("third", std::array{
+        DnmGLLite::RenderGraphAccess{second, ResourceUsage::eShaderRead},
+        DnmGLLite::RenderGraphAccess{third, ResourceUsage::eColorAttachment},
+    }, empty_pass);
+    graph.AddPass("output", std::array{
+        DnmGLLite::RenderGraphAccess{third, ResourceUsage::eShaderRead},
+        DnmGLLite::RenderGraphAccess{output, ResourceUsage::eShaderWrite},
+    }, empty_pass);
+    graph.Compile();
+
+    Check(graph.GetCulledPassCount() == 1 && graph.IsPassCulled(0), "only the unused pass should be culled");
+    Check(graph.GetImage(unused) == nullptr, "transient of a culled pass should not be created");
+    // first is read last by the second pass, third starts after it. second overlaps both
+    Check(graph.GetTransientAllocationCount() == 2, "first and third should share memory");
+
+    CheckBarriers(graph, 1, std::array{
+        ResourceBarrierDesc{ResourceUsage::eUnknown, ResourceUsage::eColorAttachment},
+    });
+    CheckBarriers(graph, 2, std::array{
+        ResourceBarrierDesc{ResourceUsage::eUnknown, ResourceUsage::eColorAttachment},
+        ResourceBarrierDesc{ResourceUsage::eColorAttachment, ResourceUsage::eShaderRead},
+    });
+    // writing third waits the reads of first in the same memory
+    CheckBarriers(graph, 3, std::array{
+        ResourceBarrierDesc{ResourceUsage::eShaderRead, ResourceUsage::eColorAttachment},
+        ResourceBarrierDesc{ResourceUsage::eColorAttachment, ResourceUsage::eShaderRead},
+    });
+    CheckBarriers(graph, 4, std::array{
+        ResourceBarrierDesc{ResourceUsage::eUnknown, ResourceUsage::eShaderWrite},
+        ResourceBarrierDesc{ResourceUsage::eColorAttachment, ResourceUsage::eShaderRead},
+    });
+
+    context->WaitForGPU();
+    return result;
+}